@@ -0,0 +1,100 @@
+#ifndef COMMAND_RING_H
+#define COMMAND_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+// bytes a command may capture, enough for an object pointer and a few arguments
+const size_t COMMAND_STORAGE_SIZE = 48;
+
+// Bounded lock-free queue of deferred calls, any thread may push, one thread
+// executes. Every slot carries a sequence number telling whose turn it is, so
+// producers only contend on the head and the consumer never touches it.
+template <uint32_t CAPACITY>
+class CommandRing {
+private:
+	static_assert(CAPACITY >= 2 && (CAPACITY & (CAPACITY - 1)) == 0, "Capacity must be a power of two!");
+
+	typedef void (*ExecuteFunction)(void *storage);
+
+	typedef struct {
+		std::atomic<uint64_t> sequence;
+		ExecuteFunction execute;
+		alignas(16) unsigned char storage[COMMAND_STORAGE_SIZE];
+	} Slot;
+
+	Slot m_slots[CAPACITY];
+
+	std::atomic<uint64_t> m_head{ 0 };
+	uint64_t m_tail = 0;
+
+	template <typename F>
+	static void _execute(void *storage) {
+		F *function = reinterpret_cast<F *>(storage);
+		(*function)();
+		function->~F();
+	}
+
+public:
+	CommandRing() {
+		for (uint32_t i = 0; i < CAPACITY; i++)
+			m_slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	CommandRing(CommandRing const &) = delete;
+	void operator=(CommandRing const &) = delete;
+
+	// returns false when the ring is full
+	template <typename F>
+	bool push(const F &function) {
+		static_assert(sizeof(F) <= COMMAND_STORAGE_SIZE, "Command captures too much!");
+		static_assert(alignof(F) <= 16, "Command is overaligned!");
+
+		uint64_t position = m_head.load(std::memory_order_relaxed);
+		Slot *slot;
+
+		while (true) {
+			slot = &m_slots[position & (CAPACITY - 1)];
+			int64_t difference = (int64_t)slot->sequence.load(std::memory_order_acquire) - (int64_t)position;
+
+			if (difference == 0) {
+				if (m_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					break;
+			} else if (difference < 0) {
+				return false;
+			} else {
+				position = m_head.load(std::memory_order_relaxed);
+			}
+		}
+
+		new (slot->storage) F(function);
+		slot->execute = &_execute<F>;
+
+		slot->sequence.store(position + 1, std::memory_order_release);
+		return true;
+	}
+
+	// consumer thread only, runs the oldest command, returns false when there was none
+	bool pop() {
+		Slot *slot = &m_slots[m_tail & (CAPACITY - 1)];
+
+		if (slot->sequence.load(std::memory_order_acquire) != m_tail + 1)
+			return false;
+
+		slot->execute(slot->storage);
+
+		slot->sequence.store(m_tail + CAPACITY, std::memory_order_release);
+		m_tail++;
+		return true;
+	}
+
+	// consumer thread only
+	bool isEmpty() const {
+		const Slot *slot = &m_slots[m_tail & (CAPACITY - 1)];
+		return slot->sequence.load(std::memory_order_acquire) != m_tail + 1;
+	}
+};
+
+#endif // !COMMAND_RING_H
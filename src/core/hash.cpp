@@ -0,0 +1,94 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "hash.h"
+
+const uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+const uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+const uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+static uint64_t rotateLeft(uint64_t value, uint32_t count) {
+	return (value << count) | (value >> (64 - count));
+}
+
+// unaligned little-endian reads, the compiler turns these into plain loads
+static uint64_t read64(const uint8_t *bytes) {
+	uint64_t value;
+	memcpy(&value, bytes, sizeof(value));
+	return value;
+}
+
+static uint32_t read32(const uint8_t *bytes) {
+	uint32_t value;
+	memcpy(&value, bytes, sizeof(value));
+	return value;
+}
+
+static uint64_t laneRound(uint64_t accumulator, uint64_t input) {
+	accumulator += input * PRIME2;
+	accumulator = rotateLeft(accumulator, 31);
+	return accumulator * PRIME1;
+}
+
+static uint64_t mergeRound(uint64_t hash, uint64_t accumulator) {
+	hash ^= laneRound(0, accumulator);
+	return hash * PRIME1 + PRIME4;
+}
+
+uint64_t hash64(const void *data, size_t size, uint64_t seed) {
+	const uint8_t *bytes = (const uint8_t *)data;
+	const uint8_t *end = bytes + size;
+	uint64_t hash;
+
+	if (size >= 32) {
+		// four independent lanes over 32 byte stripes
+		uint64_t lanes[4] = { seed + PRIME1 + PRIME2, seed + PRIME2, seed, seed - PRIME1 };
+
+		while (end - bytes >= 32) {
+			for (uint32_t i = 0; i < 4; i++)
+				lanes[i] = laneRound(lanes[i], read64(bytes + i * 8));
+
+			bytes += 32;
+		}
+
+		hash = rotateLeft(lanes[0], 1) + rotateLeft(lanes[1], 7) + rotateLeft(lanes[2], 12) +
+				rotateLeft(lanes[3], 18);
+
+		for (uint32_t i = 0; i < 4; i++)
+			hash = mergeRound(hash, lanes[i]);
+	} else {
+		hash = seed + PRIME5;
+	}
+
+	hash += size;
+
+	while (end - bytes >= 8) {
+		hash ^= laneRound(0, read64(bytes));
+		hash = rotateLeft(hash, 27) * PRIME1 + PRIME4;
+		bytes += 8;
+	}
+
+	if (end - bytes >= 4) {
+		hash ^= read32(bytes) * PRIME1;
+		hash = rotateLeft(hash, 23) * PRIME2 + PRIME3;
+		bytes += 4;
+	}
+
+	while (bytes < end) {
+		hash ^= *bytes * PRIME5;
+		hash = rotateLeft(hash, 11) * PRIME1;
+		bytes += 1;
+	}
+
+	// avalanche
+	hash ^= hash >> 33;
+	hash *= PRIME2;
+	hash ^= hash >> 29;
+	hash *= PRIME3;
+	hash ^= hash >> 32;
+
+	return hash;
+}
@@ -0,0 +1,10 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+// XXH64, fast enough that hashing a file costs less than reading it
+uint64_t hash64(const void *data, size_t size, uint64_t seed = 0);
+
+#endif // !HASH_H
@@ -0,0 +1,209 @@
+#include <cstdint>
+
+#include "job_system.h"
+
+// index of the worker running on this thread, or -1 outside of the pool
+static thread_local int32_t t_workerIndex = -1;
+
+bool JobCounter::isDone() const {
+	return m_pending.load(std::memory_order_acquire) == 0;
+}
+
+bool JobSystem::_pop(uint32_t queue, Job *job) {
+	WorkQueue *workQueue = m_queues[queue];
+	std::lock_guard<std::mutex> lock(workQueue->mutex);
+
+	if (workQueue->jobs.empty())
+		return false;
+
+	*job = std::move(workQueue->jobs.back());
+	workQueue->jobs.pop_back();
+	return true;
+}
+
+bool JobSystem::_steal(uint32_t thief, Job *job) {
+	uint32_t queueCount = m_queues.size();
+
+	for (uint32_t i = 1; i <= queueCount; i++) {
+		WorkQueue *workQueue = m_queues[(thief + i) % queueCount];
+		std::lock_guard<std::mutex> lock(workQueue->mutex);
+
+		if (workQueue->jobs.empty())
+			continue;
+
+		*job = std::move(workQueue->jobs.front());
+		workQueue->jobs.pop_front();
+		return true;
+	}
+
+	return false;
+}
+
+bool JobSystem::_runOne(uint32_t queue) {
+	if (m_queuedJobs.load(std::memory_order_acquire) == 0)
+		return false;
+
+	Job job;
+	if (!_pop(queue, &job) && !_steal(queue, &job))
+		return false;
+
+	m_queuedJobs.fetch_sub(1, std::memory_order_acq_rel);
+	_execute(job);
+	return true;
+}
+
+void JobSystem::_execute(Job &job) {
+	job.function();
+
+	if (job.counter == nullptr)
+		return;
+
+	if (job.counter->m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_finishedCondition.notify_all();
+	}
+}
+
+void JobSystem::_workerLoop(uint32_t index) {
+	t_workerIndex = index;
+
+	while (m_running) {
+		if (_runOne(index))
+			continue;
+
+		m_sleepingWorkers++;
+
+		{
+			std::unique_lock<std::mutex> lock(m_sleepMutex);
+			m_sleepCondition.wait(lock, [this]() { return m_queuedJobs > 0 || !m_running; });
+		}
+
+		m_sleepingWorkers--;
+	}
+
+	t_workerIndex = -1;
+}
+
+void JobSystem::initialize(uint32_t workerCount) {
+	if (m_running)
+		return;
+
+	if (workerCount == 0) {
+		uint32_t threadCount = std::thread::hardware_concurrency();
+		workerCount = threadCount > 1 ? threadCount - 1 : 1;
+	}
+
+	for (uint32_t i = 0; i < workerCount; i++)
+		m_queues.push_back(new WorkQueue);
+
+	m_running = true;
+
+	for (uint32_t i = 0; i < workerCount; i++)
+		m_workers.push_back(std::thread(&JobSystem::_workerLoop, this, i));
+}
+
+void JobSystem::finalize() {
+	if (!m_running)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_running = false;
+	}
+
+	m_sleepCondition.notify_all();
+
+	for (std::thread &worker : m_workers)
+		worker.join();
+
+	// jobs nobody got to are dropped, their counters would never finish anyway
+	for (WorkQueue *workQueue : m_queues)
+		delete workQueue;
+
+	m_workers.clear();
+	m_queues.clear();
+	m_queuedJobs = 0;
+}
+
+uint32_t JobSystem::workerCount() const {
+	return m_workers.size();
+}
+
+void JobSystem::schedule(const JobFunction &function, JobCounter *counter) {
+	if (counter != nullptr)
+		counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+
+	if (!m_running) {
+		// no pool, e.g. in tools that never initialized one
+		Job job = { function, counter };
+		_execute(job);
+		return;
+	}
+
+	uint32_t queue = t_workerIndex >= 0 ? (uint32_t)t_workerIndex : m_nextQueue++ % m_queues.size();
+
+	// counted before it can be taken, so the decrement in _runOne never comes first
+	m_queuedJobs.fetch_add(1, std::memory_order_seq_cst);
+
+	{
+		WorkQueue *workQueue = m_queues[queue];
+		std::lock_guard<std::mutex> lock(workQueue->mutex);
+		workQueue->jobs.push_back({ function, counter });
+	}
+
+	// pairs with the increments in _workerLoop and wait, a thread going to sleep either sees the job or gets woken
+	bool sleeping = m_sleepingWorkers.load(std::memory_order_seq_cst) > 0;
+	bool waiting = m_waitingThreads.load(std::memory_order_seq_cst) > 0;
+
+	if (!sleeping && !waiting)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_sleepMutex);
+
+	if (sleeping)
+		m_sleepCondition.notify_one();
+
+	if (waiting)
+		m_finishedCondition.notify_all();
+}
+
+void JobSystem::wait(const JobCounter &counter) {
+	while (!counter.isDone()) {
+		if (m_running) {
+			uint32_t queue = t_workerIndex >= 0 ? (uint32_t)t_workerIndex : 0;
+
+			if (_runOne(queue))
+				continue;
+		}
+
+		m_waitingThreads++;
+
+		{
+			std::unique_lock<std::mutex> lock(m_sleepMutex);
+			m_finishedCondition.wait(lock, [&]() { return counter.isDone() || m_queuedJobs > 0; });
+		}
+
+		m_waitingThreads--;
+	}
+}
+
+void JobSystem::parallelFor(uint32_t count, uint32_t batchSize, const RangeFunction &function) {
+	if (batchSize == 0)
+		batchSize = 1;
+
+	if (count <= batchSize || !m_running) {
+		function(0, count);
+		return;
+	}
+
+	JobCounter counter;
+
+	// the calling thread takes the first batch itself instead of idling
+	for (uint32_t begin = batchSize; begin < count; begin += batchSize) {
+		uint32_t end = begin + batchSize < count ? begin + batchSize : count;
+		schedule([&function, begin, end]() { function(begin, end); }, &counter);
+	}
+
+	function(0, batchSize);
+	wait(counter);
+}
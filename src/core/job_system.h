@@ -0,0 +1,89 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef std::function<void()> JobFunction;
+typedef std::function<void(uint32_t begin, uint32_t end)> RangeFunction;
+
+// Counts unfinished jobs, jobs scheduled with a counter are waited on through it.
+class JobCounter {
+private:
+	friend class JobSystem;
+	std::atomic<uint32_t> m_pending{ 0 };
+
+public:
+	bool isDone() const;
+};
+
+// Engine-wide pool of worker threads. Every worker owns a deque, it runs its own
+// jobs newest first for cache locality and steals the oldest ones from the others
+// when it runs dry. Threads waiting on a counter run jobs instead of blocking.
+class JobSystem {
+public:
+	static JobSystem &singleton() {
+		static JobSystem instance;
+		return instance;
+	}
+
+	JobSystem(JobSystem const &) = delete;
+	void operator=(JobSystem const &) = delete;
+
+private:
+	typedef struct {
+		JobFunction function;
+		JobCounter *counter;
+	} Job;
+
+	typedef struct {
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	} WorkQueue;
+
+	std::vector<std::thread> m_workers;
+	// one per worker, jobs scheduled from outside the pool are dealt out round robin
+	std::vector<WorkQueue *> m_queues;
+	std::atomic<uint32_t> m_nextQueue{ 0 };
+
+	std::atomic<bool> m_running{ false };
+	std::atomic<uint32_t> m_queuedJobs{ 0 };
+	std::atomic<uint32_t> m_sleepingWorkers{ 0 };
+	// threads in wait() with nothing to run, new jobs wake them as well
+	std::atomic<uint32_t> m_waitingThreads{ 0 };
+
+	// idle workers sleep here, finished counters wake waiting threads here too
+	std::mutex m_sleepMutex;
+	std::condition_variable m_sleepCondition;
+	std::condition_variable m_finishedCondition;
+
+	JobSystem() {}
+
+	bool _pop(uint32_t queue, Job *job);
+	bool _steal(uint32_t thief, Job *job);
+	bool _runOne(uint32_t queue);
+	void _execute(Job &job);
+	void _workerLoop(uint32_t index);
+
+public:
+	// 0 workers picks one per hardware thread, minus the calling thread
+	void initialize(uint32_t workerCount);
+	void finalize();
+
+	uint32_t workerCount() const;
+
+	void schedule(const JobFunction &function, JobCounter *counter = nullptr);
+	// runs queued jobs on the calling thread until the counter is done
+	void wait(const JobCounter &counter);
+
+	// splits [0, count) into batches of batchSize and returns once all of them ran
+	void parallelFor(uint32_t count, uint32_t batchSize, const RangeFunction &function);
+};
+
+#endif // !JOB_SYSTEM_H
@@ -0,0 +1,48 @@
+#ifndef SNAPSHOT_BUFFER_H
+#define SNAPSHOT_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free triple buffer handing whole snapshots from one writer thread to one
+// reader thread. Each side owns a buffer and they trade through the third, so
+// neither ever waits on the other and the reader always sees a complete snapshot.
+template <typename T>
+class SnapshotBuffer {
+private:
+	// set on the shared index when it holds a snapshot the reader has not taken yet
+	static const uint32_t FRESH_BIT = 4;
+	static const uint32_t INDEX_MASK = 3;
+
+	T m_buffers[3] = {};
+
+	uint32_t m_writeIndex = 0;
+	std::atomic<uint32_t> m_sharedIndex{ 1 };
+	uint32_t m_readIndex = 2;
+
+public:
+	// writer thread only
+	void publish(const T &snapshot) {
+		m_buffers[m_writeIndex] = snapshot;
+
+		uint32_t previous = m_sharedIndex.exchange(m_writeIndex | FRESH_BIT, std::memory_order_acq_rel);
+		m_writeIndex = previous & INDEX_MASK;
+	}
+
+	// reader thread only, returns whether a newer snapshot was taken
+	bool update() {
+		if ((m_sharedIndex.load(std::memory_order_relaxed) & FRESH_BIT) == 0)
+			return false;
+
+		uint32_t previous = m_sharedIndex.exchange(m_readIndex, std::memory_order_acq_rel);
+		m_readIndex = previous & INDEX_MASK;
+		return true;
+	}
+
+	// reader thread only, stays valid until the next update()
+	const T &latest() const {
+		return m_buffers[m_readIndex];
+	}
+};
+
+#endif // !SNAPSHOT_BUFFER_H
@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "file_watcher.h"
+
+// written in place or renamed over, either way the file is complete when one of these arrives
+const uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_MOVED_TO;
+
+// room for a few dozen events with names, the rest is read by the next pass of the loop
+const size_t EVENT_BUFFER_SIZE = 4096;
+
+void FileWatcher::_eventsRead() {
+	alignas(struct inotify_event) char buffer[EVENT_BUFFER_SIZE];
+
+	while (true) {
+		ssize_t length = read(m_fd, buffer, sizeof(buffer));
+
+		if (length <= 0) {
+			if (length < 0 && errno == EINTR)
+				continue;
+
+			// EAGAIN, everything queued so far was read
+			return;
+		}
+
+		ssize_t offset = 0;
+
+		while (offset < length) {
+			const struct inotify_event *event = (const struct inotify_event *)(buffer + offset);
+			offset += sizeof(struct inotify_event) + event->len;
+
+			std::unordered_map<int, std::unordered_map<std::string, std::vector<std::string>>>::iterator directory =
+					m_directories.find(event->wd);
+
+			if (directory == m_directories.end())
+				continue;
+
+			// the directory is gone, its watch was removed along with it; the files may be watched again later
+			if (event->mask & IN_IGNORED) {
+				for (std::unordered_map<std::string, std::vector<std::string>>::iterator name =
+								directory->second.begin();
+						name != directory->second.end(); ++name) {
+					for (const std::string &path : name->second)
+						m_files.erase(path);
+				}
+
+				m_directories.erase(directory);
+				continue;
+			}
+
+			if (event->len == 0)
+				continue;
+
+			std::unordered_map<std::string, std::vector<std::string>>::iterator name =
+					directory->second.find(event->name);
+
+			if (name == directory->second.end())
+				continue;
+
+			// saving twice before the next poll reloads once
+			for (const std::string &path : name->second) {
+				if (std::find(m_changed.begin(), m_changed.end(), path) == m_changed.end())
+					m_changed.push_back(path);
+			}
+		}
+	}
+}
+
+bool FileWatcher::initialize() {
+	m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+	if (m_fd < 0) {
+		printf("File watching not available, changed images will not be reloaded!\n");
+		return false;
+	}
+
+	return true;
+}
+
+void FileWatcher::finalize() {
+	if (m_fd >= 0)
+		close(m_fd);
+
+	m_fd = -1;
+	m_directories.clear();
+	m_files.clear();
+	m_changed.clear();
+}
+
+bool FileWatcher::watch(const std::string &path) {
+	if (m_fd < 0)
+		return false;
+
+	if (m_files.count(path) > 0)
+		return true;
+
+	// events carry the descriptor of the directory and the file name within it
+	size_t separator = path.rfind('/');
+	std::string directory = separator == std::string::npos ? std::string(".") : path.substr(0, separator + 1);
+	std::string name = separator == std::string::npos ? path : path.substr(separator + 1);
+
+	// a directory watched before gets the same descriptor back, whichever way its path is spelled
+	int wd = inotify_add_watch(m_fd, directory.c_str(), WATCH_MASK);
+
+	if (wd < 0) {
+		printf("File watch failed: %s\n", path.c_str());
+		return false;
+	}
+
+	m_directories[wd][name].push_back(path);
+	m_files.insert(path);
+	return true;
+}
+
+bool FileWatcher::poll(std::string *path) {
+	if (m_fd < 0)
+		return false;
+
+	_eventsRead();
+
+	if (m_changed.empty())
+		return false;
+
+	*path = std::move(m_changed.front());
+	m_changed.pop_front();
+	return true;
+}
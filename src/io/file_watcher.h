@@ -0,0 +1,47 @@
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Reports files that were written to since they were watched. The directories holding
+// them are watched rather than the files, editors often save to a temporary file and
+// rename it over the old one. Events are read without blocking whenever it is polled.
+class FileWatcher {
+public:
+	static FileWatcher &singleton() {
+		static FileWatcher instance;
+		return instance;
+	}
+
+	FileWatcher(FileWatcher const &) = delete;
+	void operator=(FileWatcher const &) = delete;
+
+private:
+	int m_fd = -1;
+
+	// by watch descriptor and file name, one directory reached through different paths gets a single descriptor,
+	// so a name may stand for several spellings of the same file
+	std::unordered_map<int, std::unordered_map<std::string, std::vector<std::string>>> m_directories;
+	std::unordered_set<std::string> m_files;
+	// changed since the last poll, each path once
+	std::deque<std::string> m_changed;
+
+	FileWatcher() {}
+
+	void _eventsRead();
+
+public:
+	bool initialize();
+	void finalize();
+
+	// paths are reported as they were passed in
+	bool watch(const std::string &path);
+	// takes the oldest changed file, false once there is none
+	bool poll(std::string *path);
+};
+
+#endif // !FILE_WATCHER_H
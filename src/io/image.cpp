@@ -1,9 +1,94 @@
 #include <cassert>
 #include <cstdint>
 #include <cstdlib>
+#include <utility>
+
+#include <sys/mman.h>
 
 #include "image.h"
 
+static uint32_t levelDimension(uint32_t size, uint32_t level) {
+	size >>= level;
+	return size > 0 ? size : 1;
+}
+
+size_t imageFormatSize(ImageFormat format, uint32_t width, uint32_t height) {
+	if (format == IMAGE_FORMAT_RGBA8)
+		return (size_t)width * height * 4;
+
+	// partial blocks at the edges are stored whole
+	size_t blockCount = (size_t)((width + 3) / 4) * ((height + 3) / 4);
+	return blockCount * (format == IMAGE_FORMAT_BC1 ? 8 : 16);
+}
+
+bool imageFormatIsCompressed(ImageFormat format) {
+	return format != IMAGE_FORMAT_RGBA8;
+}
+
+static void heapRelease(void *context, void *memory, size_t memorySize) {
+	free(memory);
+}
+
+static void mappingRelease(void *context, void *memory, size_t memorySize) {
+	munmap(memory, memorySize);
+}
+
+ImageStorage imageStorageHeap(size_t size) {
+	void *data = malloc(size);
+	if (data == nullptr)
+		return {};
+
+	return imageStorageAdopt(data, size);
+}
+
+ImageStorage imageStorageAdopt(void *data, size_t size) {
+	ImageStorage storage = {
+		.data = reinterpret_cast<uint8_t *>(data),
+		.size = size,
+		.memory = data,
+		.memorySize = size,
+		.release = heapRelease,
+		.context = nullptr,
+	};
+
+	return storage;
+}
+
+ImageStorage imageStorageMapping(void *mapping, size_t mappingSize, size_t offset) {
+	assert(offset <= mappingSize);
+
+	ImageStorage storage = {
+		.data = reinterpret_cast<uint8_t *>(mapping) + offset,
+		.size = mappingSize - offset,
+		.memory = mapping,
+		.memorySize = mappingSize,
+		.release = mappingRelease,
+		.context = nullptr,
+	};
+
+	return storage;
+}
+
+ImageStorage imageStorageView(void *data, size_t size) {
+	ImageStorage storage = {
+		.data = reinterpret_cast<uint8_t *>(data),
+		.size = size,
+		.memory = data,
+		.memorySize = size,
+		.release = nullptr,
+		.context = nullptr,
+	};
+
+	return storage;
+}
+
+void imageStorageRelease(ImageStorage *storage) {
+	if (storage->release != nullptr && storage->memory != nullptr)
+		storage->release(storage->context, storage->memory, storage->memorySize);
+
+	*storage = {};
+}
+
 uint32_t Image::width() const {
 	return m_width;
 }
@@ -12,25 +97,94 @@ uint32_t Image::height() const {
 	return m_height;
 }
 
+uint32_t Image::mipLevels() const {
+	return m_mipLevels;
+}
+
+ImageFormat Image::format() const {
+	return m_format;
+}
+
+ImageColorSpace Image::colorSpace() const {
+	return m_colorSpace;
+}
+
+bool Image::isPremultiplied() const {
+	return m_premultiplied;
+}
+
+bool Image::isEmpty() const {
+	return m_storage.data == nullptr;
+}
+
 uint8_t *Image::data() const {
-	return m_data;
+	return m_storage.data;
 }
 
 size_t Image::size() const {
-	return m_width * m_height * 4;
+	return m_size;
+}
+
+size_t Image::levelOffset(uint32_t level) const {
+	size_t offset = 0;
+
+	for (uint32_t i = 0; i < level; i++)
+		offset += levelSize(i);
+
+	return offset;
+}
+
+size_t Image::levelSize(uint32_t level) const {
+	return imageFormatSize(m_format, levelDimension(m_width, level), levelDimension(m_height, level));
+}
+
+void Image::colorSpaceSet(ImageColorSpace colorSpace) {
+	m_colorSpace = colorSpace;
 }
 
-Image::Image(uint32_t width, uint32_t height, void *data, size_t size) {
-	assert(size == width * height * 4);
+void Image::premultipliedSet(bool premultiplied) {
+	m_premultiplied = premultiplied;
+}
 
+Image::Image(uint32_t width, uint32_t height, uint32_t mipLevels, ImageFormat format, ImageStorage storage) {
 	m_width = width;
 	m_height = height;
-	m_data = reinterpret_cast<uint8_t *>(data);
+	m_mipLevels = mipLevels;
+	m_format = format;
+	m_storage = storage;
+	m_size = levelOffset(mipLevels);
+
+	assert(m_size <= storage.size);
 }
 
-Image::~Image() {
-	if (m_data == nullptr)
-		return;
+Image::Image(Image &&other) {
+	*this = std::move(other);
+}
 
-	free(m_data);
+Image &Image::operator=(Image &&other) {
+	if (this == &other)
+		return *this;
+
+	imageStorageRelease(&m_storage);
+
+	m_width = other.m_width;
+	m_height = other.m_height;
+	m_mipLevels = other.m_mipLevels;
+	m_format = other.m_format;
+	m_colorSpace = other.m_colorSpace;
+	m_premultiplied = other.m_premultiplied;
+	m_storage = other.m_storage;
+	m_size = other.m_size;
+
+	other.m_width = 0;
+	other.m_height = 0;
+	other.m_mipLevels = 0;
+	other.m_storage = {};
+	other.m_size = 0;
+
+	return *this;
+}
+
+Image::~Image() {
+	imageStorageRelease(&m_storage);
 }
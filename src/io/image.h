@@ -4,20 +4,95 @@
 #include <cstddef>
 #include <cstdint>
 
+typedef enum {
+	IMAGE_FORMAT_RGBA8,
+	// 4x4 texel blocks, 8 bytes with 1 bit alpha
+	IMAGE_FORMAT_BC1,
+	// 4x4 texel blocks, 16 bytes with interpolated alpha
+	IMAGE_FORMAT_BC3,
+	// 4x4 texel blocks, 16 bytes
+	IMAGE_FORMAT_BC7,
+} ImageFormat;
+
+typedef enum {
+	// stored as they are, e.g. masks or data sampled by shaders
+	IMAGE_COLOR_SPACE_LINEAR,
+	// sRGB encoded color, what image files hold unless they say otherwise
+	IMAGE_COLOR_SPACE_SRGB,
+} ImageColorSpace;
+
+// bytes taken by a single level of the given size
+size_t imageFormatSize(ImageFormat format, uint32_t width, uint32_t height);
+bool imageFormatIsCompressed(ImageFormat format);
+
+typedef void (*ImageReleaseFunction)(void *context, void *memory, size_t memorySize);
+
+// Memory holding pixels. Whoever provided it gets it back through the release function,
+// storage without one belongs to someone else, e.g. an arena or mapped staging memory.
+typedef struct {
+	uint8_t *data;
+	// usable bytes from data on
+	size_t size;
+	// the allocation as it is released, data may point into it
+	void *memory;
+	size_t memorySize;
+	ImageReleaseFunction release;
+	void *context;
+} ImageStorage;
+
+// malloc'd, null data when the allocation failed
+ImageStorage imageStorageHeap(size_t size);
+// takes over malloc'd memory
+ImageStorage imageStorageAdopt(void *data, size_t size);
+// takes over a file mapping with the data at the given offset
+ImageStorage imageStorageMapping(void *mapping, size_t mappingSize, size_t offset);
+// memory the storage does not own, it has to outlive the image
+ImageStorage imageStorageView(void *data, size_t size);
+// hands the memory back and empties the storage
+void imageStorageRelease(ImageStorage *storage);
+
+// Pixels of every mip level with their layout. Images own their storage, so they can
+// be moved but not copied; a moved from image is empty.
 class Image {
 private:
 	uint32_t m_width = 0;
 	uint32_t m_height = 0;
-	uint8_t *m_data = nullptr;
+	uint32_t m_mipLevels = 0;
+	ImageFormat m_format = IMAGE_FORMAT_RGBA8;
+	ImageColorSpace m_colorSpace = IMAGE_COLOR_SPACE_LINEAR;
+	// color channels are already multiplied by alpha
+	bool m_premultiplied = false;
+
+	ImageStorage m_storage = {};
+	size_t m_size = 0;
 
 public:
 	uint32_t width() const;
 	uint32_t height() const;
+	uint32_t mipLevels() const;
+	ImageFormat format() const;
+	ImageColorSpace colorSpace() const;
+	bool isPremultiplied() const;
+	bool isEmpty() const;
 	uint8_t *data() const;
+	// every level, one after another from the largest
 	size_t size() const;
 
-	Image(uint32_t width, uint32_t height, void *data, size_t size);
+	size_t levelOffset(uint32_t level) const;
+	size_t levelSize(uint32_t level) const;
+
+	void colorSpaceSet(ImageColorSpace colorSpace);
+	void premultipliedSet(bool premultiplied);
+
+	Image() {}
+	// the storage has to hold every level
+	Image(uint32_t width, uint32_t height, uint32_t mipLevels, ImageFormat format, ImageStorage storage);
+	Image(Image &&other);
+	Image &operator=(Image &&other);
 	~Image();
+
+	Image(Image const &) = delete;
+	void operator=(Image const &) = delete;
 };
 
 #endif // !IMAGE_H
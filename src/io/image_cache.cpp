@@ -0,0 +1,289 @@
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "core/hash.h"
+
+#include "image.h"
+#include "image_cache.h"
+
+const uint32_t ENTRY_MAGIC = 0x43474D49; // "IMGC"
+const uint32_t RECORD_MAGIC = 0x52474D49; // "IMGR"
+const uint32_t VERSION = 2;
+
+// entry data starts here, aligned for copies into staging memory
+const size_t ENTRY_DATA_OFFSET = 64;
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t mipLevels;
+	uint32_t colorSpace;
+	uint32_t premultiplied;
+	uint64_t size;
+	uint64_t contentHash;
+} EntryHeader;
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t sourceSize;
+	int64_t sourceModified;
+	uint64_t contentHash;
+} Record;
+
+static uint32_t mipLevelCount(uint32_t width, uint32_t height) {
+	uint32_t size = width > height ? width : height;
+	uint32_t levels = 1;
+
+	while (size > 1) {
+		size >>= 1;
+		levels++;
+	}
+
+	return levels;
+}
+
+static void stampFromStatus(const struct stat &status, ImageSourceStamp *stamp) {
+	stamp->size = status.st_size;
+	stamp->modified = (int64_t)status.st_mtim.tv_sec * 1000000000 + status.st_mtim.tv_nsec;
+}
+
+static bool directoryCreate(const std::string &path) {
+	// every parent first, existing ones are fine
+	for (size_t i = 1; i <= path.size(); i++) {
+		if (i < path.size() && path[i] != '/')
+			continue;
+
+		if (mkdir(path.substr(0, i).c_str(), 0755) != 0 && errno != EEXIST)
+			return false;
+	}
+
+	return true;
+}
+
+static std::string hashString(uint64_t hash) {
+	char string[17];
+	snprintf(string, sizeof(string), "%016llx", (unsigned long long)hash);
+	return string;
+}
+
+// written next to the destination and renamed over it, readers never see a partial file
+static bool fileWriteAtomic(const std::string &path, const void *header, size_t headerSize, const void *data,
+		size_t dataSize) {
+	size_t threadId = std::hash<std::thread::id>()(std::this_thread::get_id());
+	std::string temporaryPath = path + "." + std::to_string(getpid()) + "." + std::to_string(threadId) + ".tmp";
+
+	FILE *file = fopen(temporaryPath.c_str(), "wb");
+	if (file == nullptr)
+		return false;
+
+	fwrite(header, headerSize, 1, file);
+	if (data != nullptr)
+		fwrite(data, dataSize, 1, file);
+
+	bool success = ferror(file) == 0;
+	success = fclose(file) == 0 && success;
+
+	if (!success || rename(temporaryPath.c_str(), path.c_str()) != 0) {
+		unlink(temporaryPath.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+std::string ImageCache::_entryPath(uint64_t contentHash) const {
+	return m_directory + "/" + hashString(contentHash) + ".image";
+}
+
+std::string ImageCache::_recordPath(const char *filename) const {
+	// the same file reached through another relative path shares the record
+	char absolutePath[PATH_MAX];
+	const char *path = realpath(filename, absolutePath) != nullptr ? absolutePath : filename;
+
+	return m_directory + "/" + hashString(hash64(path, strlen(path))) + ".record";
+}
+
+bool ImageCache::_entryLoad(uint64_t contentHash, Image *image) const {
+	int file = open(_entryPath(contentHash).c_str(), O_RDONLY);
+	if (file < 0)
+		return false;
+
+	struct stat status;
+	if (fstat(file, &status) != 0 || (size_t)status.st_size < ENTRY_DATA_OFFSET) {
+		close(file);
+		return false;
+	}
+
+	size_t mappingSize = status.st_size;
+
+	// private and writable, the image may be modified in place without touching the cache
+	void *mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+	close(file);
+
+	if (mapping == MAP_FAILED)
+		return false;
+
+	EntryHeader header;
+	memcpy(&header, mapping, sizeof(header));
+
+	bool valid = header.magic == ENTRY_MAGIC && header.version == VERSION && header.contentHash == contentHash &&
+			header.format <= IMAGE_FORMAT_BC7 && header.colorSpace <= IMAGE_COLOR_SPACE_SRGB &&
+			header.size <= mappingSize - ENTRY_DATA_OFFSET;
+
+	// checked before the levels are walked, a corrupt count would shift past the width or loop for ages
+	valid = valid && header.width > 0 && header.height > 0 && header.mipLevels > 0 &&
+			header.mipLevels <= mipLevelCount(header.width, header.height);
+
+	if (valid) {
+		size_t size = 0;
+		for (uint32_t level = 0; level < header.mipLevels; level++) {
+			uint32_t width = header.width >> level > 0 ? header.width >> level : 1;
+			uint32_t height = header.height >> level > 0 ? header.height >> level : 1;
+			size += imageFormatSize((ImageFormat)header.format, width, height);
+		}
+
+		valid = size == header.size;
+	}
+
+	if (!valid) {
+		munmap(mapping, mappingSize);
+		return false;
+	}
+
+	// the pages are read in as the upload copies them, ahead of it with this
+	madvise(mapping, mappingSize, MADV_SEQUENTIAL | MADV_WILLNEED);
+
+	ImageStorage storage = imageStorageMapping(mapping, mappingSize, ENTRY_DATA_OFFSET);
+	*image = Image(header.width, header.height, header.mipLevels, (ImageFormat)header.format, storage);
+	image->colorSpaceSet((ImageColorSpace)header.colorSpace);
+	image->premultipliedSet(header.premultiplied != 0);
+	return true;
+}
+
+bool imageSourceStamp(FILE *file, ImageSourceStamp *stamp) {
+	struct stat status;
+	if (fstat(fileno(file), &status) != 0)
+		return false;
+
+	stampFromStatus(status, stamp);
+	return true;
+}
+
+void ImageCache::_recordStore(const char *filename, const ImageSourceStamp &stamp, uint64_t contentHash) const {
+	Record record = {
+		.magic = RECORD_MAGIC,
+		.version = VERSION,
+		.sourceSize = stamp.size,
+		.sourceModified = stamp.modified,
+		.contentHash = contentHash,
+	};
+
+	fileWriteAtomic(_recordPath(filename), &record, sizeof(record), nullptr, 0);
+}
+
+void ImageCache::initialize(const char *directory) {
+	if (directory != nullptr) {
+		m_directory = directory;
+	} else if (getenv("XDG_CACHE_HOME") != nullptr && getenv("XDG_CACHE_HOME")[0] != '\0') {
+		m_directory = std::string(getenv("XDG_CACHE_HOME")) + "/2d-renderer/images";
+	} else if (getenv("HOME") != nullptr) {
+		m_directory = std::string(getenv("HOME")) + "/.cache/2d-renderer/images";
+	} else {
+		printf("Image cache disabled, no cache directory!\n");
+		return;
+	}
+
+	m_enabled = directoryCreate(m_directory);
+
+	if (!m_enabled)
+		printf("Image cache disabled, %s could not be created!\n", m_directory.c_str());
+}
+
+bool ImageCache::isEnabled() const {
+	return m_enabled;
+}
+
+bool ImageCache::load(const char *filename, Image *image) const {
+	if (!m_enabled)
+		return false;
+
+	struct stat status;
+	if (stat(filename, &status) != 0)
+		return false;
+
+	ImageSourceStamp stamp;
+	stampFromStatus(status, &stamp);
+
+	FILE *file = fopen(_recordPath(filename).c_str(), "rb");
+	if (file == nullptr)
+		return false;
+
+	Record record;
+	bool valid = fread(&record, sizeof(record), 1, file) == 1;
+	fclose(file);
+
+	if (!valid || record.magic != RECORD_MAGIC || record.version != VERSION || record.sourceSize != stamp.size ||
+			record.sourceModified != stamp.modified)
+		return false;
+
+	return _entryLoad(record.contentHash, image);
+}
+
+bool ImageCache::loadContent(
+		const char *filename, const ImageSourceStamp &stamp, uint64_t contentHash, Image *image) const {
+	if (!m_enabled)
+		return false;
+
+	if (!_entryLoad(contentHash, image))
+		return false;
+
+	// the next run finds it without reading the file again
+	_recordStore(filename, stamp, contentHash);
+	return true;
+}
+
+void ImageCache::store(
+		const char *filename, const ImageSourceStamp &stamp, uint64_t contentHash, const Image *image) const {
+	if (!m_enabled)
+		return;
+
+	uint8_t header[ENTRY_DATA_OFFSET] = {};
+
+	EntryHeader entryHeader = {
+		.magic = ENTRY_MAGIC,
+		.version = VERSION,
+		.format = image->format(),
+		.width = image->width(),
+		.height = image->height(),
+		.mipLevels = image->mipLevels(),
+		.colorSpace = image->colorSpace(),
+		.premultiplied = image->isPremultiplied(),
+		.size = image->size(),
+		.contentHash = contentHash,
+	};
+
+	memcpy(header, &entryHeader, sizeof(entryHeader));
+
+	if (!fileWriteAtomic(_entryPath(contentHash), header, sizeof(header), image->data(), image->size())) {
+		printf("Image cache entry could not be written!\n");
+		return;
+	}
+
+	_recordStore(filename, stamp, contentHash);
+}
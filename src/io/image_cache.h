@@ -0,0 +1,54 @@
+#ifndef IMAGE_CACHE_H
+#define IMAGE_CACHE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+class Image;
+
+// the version of a source file an entry was made from, taken before the file is read
+typedef struct {
+	uint64_t size;
+	int64_t modified;
+} ImageSourceStamp;
+
+bool imageSourceStamp(FILE *file, ImageSourceStamp *stamp);
+
+// Keeps decoded images on disk so later runs map them instead of decoding. Entries are named
+// by a hash of the source file contents, a small record per source path remembers the size,
+// modification time and content hash it had, so an unchanged file is not even read.
+class ImageCache {
+public:
+	static ImageCache &singleton() {
+		static ImageCache instance;
+		return instance;
+	}
+
+	ImageCache(ImageCache const &) = delete;
+	void operator=(ImageCache const &) = delete;
+
+private:
+	bool m_enabled = false;
+	std::string m_directory;
+
+	ImageCache() {}
+
+	std::string _entryPath(uint64_t contentHash) const;
+	std::string _recordPath(const char *filename) const;
+	bool _entryLoad(uint64_t contentHash, Image *image) const;
+	void _recordStore(const char *filename, const ImageSourceStamp &stamp, uint64_t contentHash) const;
+
+public:
+	// nullptr picks the user cache directory, which is created when missing
+	void initialize(const char *directory);
+	bool isEnabled() const;
+
+	// maps the entry into the image when the record of the file still matches it
+	bool load(const char *filename, Image *image) const;
+	// for files that changed on disk but whose contents were decoded before, e.g. touched or copied
+	bool loadContent(const char *filename, const ImageSourceStamp &stamp, uint64_t contentHash, Image *image) const;
+	void store(const char *filename, const ImageSourceStamp &stamp, uint64_t contentHash, const Image *image) const;
+};
+
+#endif // !IMAGE_CACHE_H
@@ -0,0 +1,168 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include <dirent.h>
+#include <strings.h>
+#include <sys/stat.h>
+
+#include "core/hash.h"
+#include "core/job_system.h"
+
+#include "image.h"
+#include "image_importer.h"
+#include "image_loader.h"
+
+// what stb and the KTX2 and QOI readers decode, other files in dropped directories are skipped
+const char *IMAGE_EXTENSIONS[] = { "png", "jpg", "jpeg", "tga", "bmp", "psd", "gif", "hdr", "pic", "pnm", "ppm",
+	"pgm", "ktx2", "qoi" };
+
+static bool hasImageExtension(const char *name) {
+	const char *extension = strrchr(name, '.');
+	if (extension == nullptr)
+		return false;
+
+	for (const char *known : IMAGE_EXTENSIONS) {
+		if (strcasecmp(extension + 1, known) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+void ImageImporter::_directoryWalk(const std::string &path) {
+	DIR *directory = opendir(path.c_str());
+	if (directory == nullptr) {
+		printf("Directory failed to open: %s\n", path.c_str());
+		return;
+	}
+
+	while (dirent *entry = readdir(directory)) {
+		if (m_cancelled)
+			break;
+
+		// hidden entries are mostly editor and VCS clutter
+		if (entry->d_name[0] == '.')
+			continue;
+
+		std::string entryPath = path + "/" + entry->d_name;
+
+		// links are not followed into directories, a link to a parent would be walked forever
+		struct stat status;
+		if (lstat(entryPath.c_str(), &status) != 0)
+			continue;
+
+		// linked files still count, their target decides what they are
+		if (S_ISLNK(status.st_mode) && (stat(entryPath.c_str(), &status) != 0 || S_ISDIR(status.st_mode)))
+			continue;
+
+		if (S_ISDIR(status.st_mode))
+			_directoryWalk(entryPath);
+		else if (S_ISREG(status.st_mode) && hasImageExtension(entry->d_name))
+			_fileQueue(entryPath);
+	}
+
+	closedir(directory);
+}
+
+void ImageImporter::_fileQueue(const std::string &path) {
+	m_queued++;
+	JobSystem::singleton().schedule([this, path]() { _fileLoad(path); }, &m_counter);
+}
+
+void ImageImporter::_fileLoad(const std::string &path) {
+	Image image;
+
+	if (m_cancelled || !imageLoad(path.c_str(), &image)) {
+		m_failed++;
+		m_finished++;
+		return;
+	}
+
+	// hashed here on the worker, identical images share a texture later on
+	uint64_t pixelHash = hash64(image.data(), image.size());
+
+	bool first;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		first = m_results.empty();
+		m_results.push_back({ path, std::move(image), pixelHash });
+	}
+
+	m_finished++;
+
+	// one wake up per drain, the poller takes everything that piled up meanwhile
+	if (first && m_notify)
+		m_notify();
+}
+
+void ImageImporter::notifySet(const ImportNotifyFunction &notify) {
+	m_notify = notify;
+}
+
+void ImageImporter::queue(const char *path) {
+	m_cancelled = false;
+
+	// a new batch, progress counts from zero again
+	if (m_counter.isDone()) {
+		m_queued = 0;
+		m_finished = 0;
+		m_failed = 0;
+	}
+
+	std::string file = path;
+
+	// walked on a worker, a large tree would stall the caller
+	JobSystem::singleton().schedule(
+			[this, file]() {
+				struct stat status;
+
+				if (stat(file.c_str(), &status) == 0 && S_ISDIR(status.st_mode)) {
+					_directoryWalk(file);
+					return;
+				}
+
+				_fileQueue(file);
+			},
+			&m_counter);
+}
+
+bool ImageImporter::poll(std::string *path, Image *image, uint64_t *pixelHash) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_results.empty())
+		return false;
+
+	*path = std::move(m_results.front().path);
+	*image = std::move(m_results.front().image);
+	*pixelHash = m_results.front().pixelHash;
+	m_results.pop_front();
+	return true;
+}
+
+ImportProgress ImageImporter::progress() const {
+	ImportProgress progress = {
+		.queued = m_queued,
+		.finished = m_finished,
+		.failed = m_failed,
+	};
+
+	return progress;
+}
+
+bool ImageImporter::isBusy() const {
+	return !m_counter.isDone();
+}
+
+void ImageImporter::cancel() {
+	m_cancelled = true;
+	JobSystem::singleton().wait(m_counter);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_results.clear();
+}
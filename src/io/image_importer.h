@@ -0,0 +1,77 @@
+#ifndef IMAGE_IMPORTER_H
+#define IMAGE_IMPORTER_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+
+#include "core/job_system.h"
+
+#include "image.h"
+
+typedef std::function<void()> ImportNotifyFunction;
+
+typedef struct {
+	// files found so far, grows while directories are walked
+	uint32_t queued;
+	uint32_t finished;
+	uint32_t failed;
+} ImportProgress;
+
+// Loads batches of image files on the job system, every file is decoded, converted and
+// cached on a worker. Finished images wait here until the main thread polls them, in
+// the order they completed.
+class ImageImporter {
+public:
+	static ImageImporter &singleton() {
+		static ImageImporter instance;
+		return instance;
+	}
+
+	ImageImporter(ImageImporter const &) = delete;
+	void operator=(ImageImporter const &) = delete;
+
+private:
+	typedef struct {
+		std::string path;
+		Image image;
+		uint64_t pixelHash;
+	} Result;
+
+	std::mutex m_mutex;
+	std::deque<Result> m_results;
+	ImportNotifyFunction m_notify;
+
+	JobCounter m_counter;
+	std::atomic<bool> m_cancelled{ false };
+
+	std::atomic<uint32_t> m_queued{ 0 };
+	std::atomic<uint32_t> m_finished{ 0 };
+	std::atomic<uint32_t> m_failed{ 0 };
+
+	ImageImporter() {}
+
+	void _directoryWalk(const std::string &path);
+	void _fileQueue(const std::string &path);
+	void _fileLoad(const std::string &path);
+
+public:
+	// called from a worker whenever results become ready while none were waiting, e.g. to wake an event loop
+	void notifySet(const ImportNotifyFunction &notify);
+
+	// files are loaded whatever they are named, directories are walked for known image extensions
+	void queue(const char *path);
+	// takes the oldest finished image with a hash of its pixels, false once there is none
+	bool poll(std::string *path, Image *image, uint64_t *pixelHash);
+
+	ImportProgress progress() const;
+	bool isBusy() const;
+
+	// skips what has not started yet and waits for the rest, then drops every result
+	void cancel();
+};
+
+#endif // !IMAGE_IMPORTER_H
@@ -1,13 +1,18 @@
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
-#include <cstdlib>
-#include <cstring>
 
 #include <stb/stb_image.h>
 
+#include "core/hash.h"
+
 #include "image.h"
+#include "image_cache.h"
 #include "image_loader.h"
+#include "image_pool.h"
+#include "ktx2.h"
+#include "pixel_conversion.h"
+#include "qoi.h"
 
 static void debugInfo(uint32_t width, uint32_t height) {
 	printf("Image loaded!\n");
@@ -15,39 +20,152 @@ static void debugInfo(uint32_t width, uint32_t height) {
 	printf("Height: %dpx\n", height);
 }
 
-static Image *imageCreate(stbi_uc *data, int width, int height, int numChannels) {
+// straight alpha from a container, multiplied once so the renderer only ever blends premultiplied color
+static void imagePremultiply(Image *image) {
+	if (image->isPremultiplied())
+		return;
+
+	if (imageFormatIsCompressed(image->format())) {
+		// blocks cannot be multiplied without encoding them again, the encoder tool does it up front
+		printf("Compressed image has straight alpha, translucent edges will be too bright!\n");
+		return;
+	}
+
+	size_t pixelCount = image->size() / 4;
+
+	if (image->colorSpace() == IMAGE_COLOR_SPACE_SRGB)
+		pixelsPremultiplySRGB(image->data(), image->data(), pixelCount);
+	else
+		pixelsPremultiply(image->data(), image->data(), pixelCount);
+
+	image->premultipliedSet(true);
+}
+
+static bool imageCreate(stbi_uc *data, int width, int height, int numChannels, Image *image) {
 	if (data == nullptr) {
 		perror("Image failed to load!\n");
-		return nullptr;
+		return false;
 	}
 
-	uint32_t pixelCount = width * height;
+	size_t pixelCount = (size_t)width * height;
 	size_t size = pixelCount * 4;
 
+	ImageStorage storage;
 	if (numChannels == 4) {
-		debugInfo(width, height);
-		return new Image(width, height, data, size);
+		storage = imageStorageAdopt(data, size);
+	} else {
+		storage = ImagePool::singleton().allocate(size);
+		if (storage.data != nullptr)
+			pixelsToRGBA(data, numChannels, storage.data, pixelCount);
+
+		stbi_image_free(data);
 	}
 
-	uint8_t *newData = (uint8_t *)malloc(size);
-	for (uint32_t pixel = 0; pixel < pixelCount; pixel++) {
-		uint8_t channels[4] = { 0, 0, 0, 255 };
-		memcpy(channels, &data[pixel * numChannels], numChannels);
-		memcpy(&newData[pixel * 4], channels, 4);
+	if (storage.data == nullptr) {
+		printf("Image is too large to load!\n");
+		return false;
 	}
 
+	// gray and RGB images are opaque, there is nothing to multiply
+	if (numChannels == 2 || numChannels == 4)
+		pixelsPremultiplySRGB(storage.data, storage.data, pixelCount);
+
+	*image = Image(width, height, 1, IMAGE_FORMAT_RGBA8, storage);
+	image->colorSpaceSet(IMAGE_COLOR_SPACE_SRGB);
+	image->premultipliedSet(true);
+
 	debugInfo(width, height);
-	return new Image(width, height, newData, size);
+	return true;
 }
 
-Image *imageLoad(const char *filename) {
-	int width, height, numChannels;
-	stbi_uc *data = stbi_load(filename, &width, &height, &numChannels, STBI_default);
-	return imageCreate(data, width, height, numChannels);
+bool imageLoad(const char *filename, Image *image) {
+	ImageCache &cache = ImageCache::singleton();
+
+	// decoded before and unchanged since, mapped straight from the cache
+	if (cache.load(filename, image)) {
+		debugInfo(image->width(), image->height());
+		return true;
+	}
+
+	FILE *file = fopen(filename, "rb");
+	if (file == nullptr) {
+		perror("Image failed to load!\n");
+		return false;
+	}
+
+	fseek(file, 0, SEEK_END);
+	long fileSize = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	if (fileSize <= 0) {
+		printf("Image failed to load!\n");
+		fclose(file);
+		return false;
+	}
+
+	ImageSourceStamp stamp;
+	bool stamped = imageSourceStamp(file, &stamp);
+
+	// only lives until the image is decoded, the pool hands the same memory to the next file
+	ImageStorage buffer = ImagePool::singleton().allocate(fileSize);
+	if (buffer.data == nullptr) {
+		printf("Image failed to load!\n");
+		fclose(file);
+		return false;
+	}
+
+	size_t bufferSize = fread(buffer.data, 1, fileSize, file);
+	fclose(file);
+
+	bool loaded;
+
+	// pre-encoded textures are GPU-ready already and QOI decodes about as fast as an entry is read,
+	// caching either would mostly duplicate the file
+	if (!cache.isEnabled() || !stamped || ktx2Check(buffer.data, bufferSize) || qoiCheck(buffer.data, bufferSize)) {
+		loaded = imageLoadFromMemory(buffer.data, bufferSize, image);
+		imageStorageRelease(&buffer);
+		return loaded;
+	}
+
+	uint64_t contentHash = hash64(buffer.data, bufferSize);
+
+	if (cache.loadContent(filename, stamp, contentHash, image)) {
+		debugInfo(image->width(), image->height());
+		imageStorageRelease(&buffer);
+		return true;
+	}
+
+	loaded = imageLoadFromMemory(buffer.data, bufferSize, image);
+	imageStorageRelease(&buffer);
+
+	if (loaded)
+		cache.store(filename, stamp, contentHash, image);
+
+	return loaded;
 }
 
-Image *imageLoadFromMemory(void *buffer, size_t bufferSize) {
+bool imageLoadFromMemory(const void *buffer, size_t bufferSize, Image *image) {
+	// pre-encoded textures, uploaded as they are
+	if (ktx2Check(buffer, bufferSize)) {
+		if (!ktx2LoadFromMemory(buffer, bufferSize, image))
+			return false;
+
+		imagePremultiply(image);
+		debugInfo(image->width(), image->height());
+		return true;
+	}
+
+	if (qoiCheck(buffer, bufferSize)) {
+		if (!qoiLoadFromMemory(buffer, bufferSize, image))
+			return false;
+
+		imagePremultiply(image);
+		debugInfo(image->width(), image->height());
+		return true;
+	}
+
 	int width, height, numChannels;
-	stbi_uc *data = stbi_load_from_memory((stbi_uc *)buffer, bufferSize, &width, &height, &numChannels, STBI_default);
-	return imageCreate(data, width, height, numChannels);
+	stbi_uc *data =
+			stbi_load_from_memory((const stbi_uc *)buffer, bufferSize, &width, &height, &numChannels, STBI_default);
+	return imageCreate(data, width, height, numChannels, image);
 }
@@ -5,7 +5,8 @@
 
 class Image;
 
-Image *imageLoad(const char *filename);
-Image *imageLoadFromMemory(void *buffer, size_t bufferSize);
+// both leave the image as it was when loading fails
+bool imageLoad(const char *filename, Image *image);
+bool imageLoadFromMemory(const void *buffer, size_t bufferSize, Image *image);
 
 #endif // !IMAGE_LOADER_H
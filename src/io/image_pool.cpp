@@ -0,0 +1,123 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+#include "image.h"
+#include "image_pool.h"
+
+// the smallest slab, images below it are rare and cheap to allocate anyway
+const uint32_t SMALLEST_CLASS_SHIFT = 16;
+
+static uint32_t sizeClass(size_t size) {
+	uint32_t index = 0;
+
+	while (index < IMAGE_POOL_CLASS_COUNT && ((size_t)1 << (SMALLEST_CLASS_SHIFT + index)) < size)
+		index++;
+
+	return index;
+}
+
+static size_t classSize(uint32_t index) {
+	return (size_t)1 << (SMALLEST_CLASS_SHIFT + index);
+}
+
+ImagePool::~ImagePool() {
+	trim();
+}
+
+void ImagePool::_release(void *context, void *memory, size_t memorySize) {
+	ImagePool *pool = reinterpret_cast<ImagePool *>(context);
+
+	{
+		std::lock_guard<std::mutex> lock(pool->m_mutex);
+
+		if (pool->m_retained + memorySize <= pool->m_retainedCap) {
+			pool->m_freeSlabs[sizeClass(memorySize)].push_back(memory);
+			pool->m_retained += memorySize;
+			return;
+		}
+	}
+
+	free(memory);
+}
+
+void ImagePool::retainedCapSet(size_t bytes) {
+	std::vector<void *> excess;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_retainedCap = bytes;
+
+		// the largest slabs go first, they free the most for the fewest lost reuses
+		for (uint32_t i = IMAGE_POOL_CLASS_COUNT; i-- > 0 && m_retained > m_retainedCap;) {
+			while (!m_freeSlabs[i].empty() && m_retained > m_retainedCap) {
+				excess.push_back(m_freeSlabs[i].back());
+				m_freeSlabs[i].pop_back();
+				m_retained -= classSize(i);
+			}
+		}
+	}
+
+	for (void *slab : excess)
+		free(slab);
+}
+
+size_t ImagePool::retained() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_retained;
+}
+
+ImageStorage ImagePool::allocate(size_t size) {
+	uint32_t index = sizeClass(size);
+	if (index == IMAGE_POOL_CLASS_COUNT)
+		return imageStorageHeap(size);
+
+	void *slab = nullptr;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (!m_freeSlabs[index].empty()) {
+			slab = m_freeSlabs[index].back();
+			m_freeSlabs[index].pop_back();
+			m_retained -= classSize(index);
+		}
+	}
+
+	if (slab == nullptr)
+		slab = malloc(classSize(index));
+
+	if (slab == nullptr)
+		return {};
+
+	ImageStorage storage = {
+		.data = reinterpret_cast<uint8_t *>(slab),
+		.size = size,
+		.memory = slab,
+		.memorySize = classSize(index),
+		.release = _release,
+		.context = this,
+	};
+
+	return storage;
+}
+
+void ImagePool::trim() {
+	std::vector<void *> slabs;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		for (std::vector<void *> &freeSlabs : m_freeSlabs) {
+			slabs.insert(slabs.end(), freeSlabs.begin(), freeSlabs.end());
+			freeSlabs.clear();
+		}
+
+		m_retained = 0;
+	}
+
+	for (void *slab : slabs)
+		free(slab);
+}
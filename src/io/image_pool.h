@@ -0,0 +1,51 @@
+#ifndef IMAGE_POOL_H
+#define IMAGE_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "image.h"
+
+// slabs come in power of two sizes from 64 KiB to 256 MiB, larger requests go straight to the heap
+const uint32_t IMAGE_POOL_CLASS_COUNT = 13;
+
+// Reusable memory for decoding. Released storage goes back to a free list of its size
+// class instead of the heap, so loading image after image stops allocating once the
+// lists are warm. Slabs untouched past their request stay virtual, the rounding costs
+// address space rather than memory.
+class ImagePool {
+public:
+	static ImagePool &singleton() {
+		static ImagePool instance;
+		return instance;
+	}
+
+	ImagePool(ImagePool const &) = delete;
+	void operator=(ImagePool const &) = delete;
+
+private:
+	std::mutex m_mutex;
+	std::vector<void *> m_freeSlabs[IMAGE_POOL_CLASS_COUNT];
+
+	size_t m_retainedCap = 256 << 20;
+	size_t m_retained = 0;
+
+	ImagePool() {}
+	~ImagePool();
+
+	static void _release(void *context, void *memory, size_t memorySize);
+
+public:
+	// bytes kept on the free lists at most, lowering it frees the excess right away
+	void retainedCapSet(size_t bytes);
+	size_t retained();
+
+	// null data when the allocation failed, released through imageStorageRelease or the image owning it
+	ImageStorage allocate(size_t size);
+	// frees every idle slab
+	void trim();
+};
+
+#endif // !IMAGE_POOL_H
@@ -0,0 +1,370 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "image.h"
+#include "image_pool.h"
+#include "ktx2.h"
+
+// fields are little-endian, as is every host this runs on, so they are copied as they are
+
+const uint8_t IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+// VkFormat values, the container names its format the way Vulkan does
+const uint32_t FORMAT_R8G8B8A8_UNORM = 37;
+const uint32_t FORMAT_R8G8B8A8_SRGB = 43;
+const uint32_t FORMAT_BC1_RGBA_UNORM_BLOCK = 133;
+const uint32_t FORMAT_BC1_RGBA_SRGB_BLOCK = 134;
+const uint32_t FORMAT_BC3_UNORM_BLOCK = 137;
+const uint32_t FORMAT_BC3_SRGB_BLOCK = 138;
+const uint32_t FORMAT_BC7_UNORM_BLOCK = 145;
+const uint32_t FORMAT_BC7_SRGB_BLOCK = 146;
+
+// Khronos data format descriptor values
+const uint8_t DF_MODEL_RGBSDA = 1;
+const uint8_t DF_MODEL_BC1A = 128;
+const uint8_t DF_MODEL_BC3 = 130;
+const uint8_t DF_MODEL_BC7 = 134;
+const uint8_t DF_PRIMARIES_BT709 = 1;
+const uint8_t DF_TRANSFER_LINEAR = 1;
+const uint8_t DF_TRANSFER_SRGB = 2;
+const uint8_t DF_FLAG_ALPHA_PREMULTIPLIED = 1;
+const uint8_t DF_CHANNEL_ALPHA = 15;
+// sample qualifier, alpha is never sRGB encoded
+const uint8_t DF_SAMPLE_LINEAR = 1 << 4;
+const uint16_t DF_VERSION = 2;
+
+const uint32_t MAX_LEVELS = 32;
+const uint32_t MAX_SAMPLES = 4;
+
+typedef struct {
+	uint32_t vkFormat;
+	uint32_t typeSize;
+	uint32_t pixelWidth;
+	uint32_t pixelHeight;
+	uint32_t pixelDepth;
+	uint32_t layerCount;
+	uint32_t faceCount;
+	uint32_t levelCount;
+	uint32_t supercompressionScheme;
+} Header;
+
+// kept apart from the header, together they would pick up padding before the 64 bit fields
+typedef struct {
+	uint32_t dfdByteOffset;
+	uint32_t dfdByteLength;
+	uint32_t kvdByteOffset;
+	uint32_t kvdByteLength;
+	uint64_t sgdByteOffset;
+	uint64_t sgdByteLength;
+} Index;
+
+typedef struct {
+	uint64_t byteOffset;
+	uint64_t byteLength;
+	uint64_t uncompressedByteLength;
+} LevelIndex;
+
+typedef struct {
+	uint16_t bitOffset;
+	uint8_t bitLength;
+	uint8_t channelType;
+	uint8_t samplePosition[4];
+	uint32_t sampleLower;
+	uint32_t sampleUpper;
+} Sample;
+
+typedef struct {
+	uint32_t totalSize;
+	uint32_t descriptorType;
+	uint16_t versionNumber;
+	uint16_t descriptorBlockSize;
+	uint8_t colorModel;
+	uint8_t colorPrimaries;
+	uint8_t transferFunction;
+	uint8_t flags;
+	uint8_t texelBlockDimension[4];
+	uint8_t bytesPlane[8];
+	Sample samples[MAX_SAMPLES];
+} DataFormatDescriptor;
+
+static bool formatFromVulkan(uint32_t vkFormat, ImageFormat *format, ImageColorSpace *colorSpace) {
+	switch (vkFormat) {
+		case FORMAT_R8G8B8A8_UNORM:
+		case FORMAT_R8G8B8A8_SRGB:
+			*format = IMAGE_FORMAT_RGBA8;
+			break;
+		case FORMAT_BC1_RGBA_UNORM_BLOCK:
+		case FORMAT_BC1_RGBA_SRGB_BLOCK:
+			*format = IMAGE_FORMAT_BC1;
+			break;
+		case FORMAT_BC3_UNORM_BLOCK:
+		case FORMAT_BC3_SRGB_BLOCK:
+			*format = IMAGE_FORMAT_BC3;
+			break;
+		case FORMAT_BC7_UNORM_BLOCK:
+		case FORMAT_BC7_SRGB_BLOCK:
+			*format = IMAGE_FORMAT_BC7;
+			break;
+		default:
+			return false;
+	}
+
+	bool srgb = vkFormat == FORMAT_R8G8B8A8_SRGB || vkFormat == FORMAT_BC1_RGBA_SRGB_BLOCK ||
+			vkFormat == FORMAT_BC3_SRGB_BLOCK || vkFormat == FORMAT_BC7_SRGB_BLOCK;
+
+	*colorSpace = srgb ? IMAGE_COLOR_SPACE_SRGB : IMAGE_COLOR_SPACE_LINEAR;
+	return true;
+}
+
+static uint32_t formatToVulkan(ImageFormat format, ImageColorSpace colorSpace) {
+	bool srgb = colorSpace == IMAGE_COLOR_SPACE_SRGB;
+
+	switch (format) {
+		case IMAGE_FORMAT_BC1:
+			return srgb ? FORMAT_BC1_RGBA_SRGB_BLOCK : FORMAT_BC1_RGBA_UNORM_BLOCK;
+		case IMAGE_FORMAT_BC3:
+			return srgb ? FORMAT_BC3_SRGB_BLOCK : FORMAT_BC3_UNORM_BLOCK;
+		case IMAGE_FORMAT_BC7:
+			return srgb ? FORMAT_BC7_SRGB_BLOCK : FORMAT_BC7_UNORM_BLOCK;
+		default:
+			return srgb ? FORMAT_R8G8B8A8_SRGB : FORMAT_R8G8B8A8_UNORM;
+	}
+}
+
+// bytes per texel, or per block for compressed formats
+static uint32_t formatBlockSize(ImageFormat format) {
+	switch (format) {
+		case IMAGE_FORMAT_BC1:
+			return 8;
+		case IMAGE_FORMAT_BC3:
+		case IMAGE_FORMAT_BC7:
+			return 16;
+		default:
+			return 4;
+	}
+}
+
+static DataFormatDescriptor descriptorCreate(const Image *image) {
+	ImageFormat format = image->format();
+	bool srgb = image->colorSpace() == IMAGE_COLOR_SPACE_SRGB;
+
+	DataFormatDescriptor descriptor = {};
+	descriptor.versionNumber = DF_VERSION;
+	descriptor.colorPrimaries = DF_PRIMARIES_BT709;
+	descriptor.transferFunction = srgb ? DF_TRANSFER_SRGB : DF_TRANSFER_LINEAR;
+	descriptor.flags = image->isPremultiplied() ? DF_FLAG_ALPHA_PREMULTIPLIED : 0;
+	descriptor.bytesPlane[0] = formatBlockSize(format);
+
+	uint32_t sampleCount = 1;
+
+	if (imageFormatIsCompressed(format)) {
+		// dimensions are stored minus one
+		descriptor.texelBlockDimension[0] = 3;
+		descriptor.texelBlockDimension[1] = 3;
+
+		for (Sample &sample : descriptor.samples)
+			sample.sampleUpper = UINT32_MAX;
+	}
+
+	switch (format) {
+		case IMAGE_FORMAT_BC1:
+			descriptor.colorModel = DF_MODEL_BC1A;
+			// alpha present channel
+			descriptor.samples[0].channelType = 1;
+			descriptor.samples[0].bitLength = 63;
+			break;
+		case IMAGE_FORMAT_BC3:
+			descriptor.colorModel = DF_MODEL_BC3;
+			// the alpha block comes first
+			descriptor.samples[0].channelType = DF_CHANNEL_ALPHA | (srgb ? DF_SAMPLE_LINEAR : 0);
+			descriptor.samples[0].bitLength = 63;
+			descriptor.samples[1].bitOffset = 64;
+			descriptor.samples[1].bitLength = 63;
+			sampleCount = 2;
+			break;
+		case IMAGE_FORMAT_BC7:
+			descriptor.colorModel = DF_MODEL_BC7;
+			descriptor.samples[0].bitLength = 127;
+			break;
+		default:
+			descriptor.colorModel = DF_MODEL_RGBSDA;
+
+			for (uint32_t i = 0; i < 4; i++) {
+				descriptor.samples[i].bitOffset = i * 8;
+				descriptor.samples[i].bitLength = 7;
+				descriptor.samples[i].channelType = i < 3 ? i : DF_CHANNEL_ALPHA | (srgb ? DF_SAMPLE_LINEAR : 0);
+				descriptor.samples[i].sampleUpper = 255;
+			}
+
+			sampleCount = 4;
+			break;
+	}
+
+	descriptor.descriptorBlockSize = 24 + sampleCount * sizeof(Sample);
+	descriptor.totalSize = sizeof(uint32_t) + descriptor.descriptorBlockSize;
+	return descriptor;
+}
+
+static uint32_t levelDimension(uint32_t size, uint32_t level) {
+	size >>= level;
+	return size > 0 ? size : 1;
+}
+
+bool ktx2Check(const void *buffer, size_t bufferSize) {
+	return bufferSize >= sizeof(IDENTIFIER) && memcmp(buffer, IDENTIFIER, sizeof(IDENTIFIER)) == 0;
+}
+
+bool ktx2LoadFromMemory(const void *buffer, size_t bufferSize, Image *image) {
+	const uint8_t *bytes = (const uint8_t *)buffer;
+
+	Header header;
+	if (!ktx2Check(buffer, bufferSize) || bufferSize < sizeof(IDENTIFIER) + sizeof(Header)) {
+		printf("Invalid KTX2 file!\n");
+		return false;
+	}
+
+	memcpy(&header, bytes + sizeof(IDENTIFIER), sizeof(Header));
+
+	ImageFormat format;
+	ImageColorSpace colorSpace;
+	if (!formatFromVulkan(header.vkFormat, &format, &colorSpace)) {
+		printf("Unsupported KTX2 format: %u!\n", header.vkFormat);
+		return false;
+	}
+
+	// a zero height is a 1D texture
+	if (header.pixelWidth == 0 || header.pixelHeight == 0 || header.supercompressionScheme != 0 ||
+			header.pixelDepth != 0 || header.layerCount > 1 || header.faceCount != 1) {
+		printf("Only plain 2D KTX2 images are supported!\n");
+		return false;
+	}
+
+	// zero asks the loader to generate the levels, which is what happens to a single one anyway
+	uint32_t levelCount = header.levelCount > 0 ? header.levelCount : 1;
+	size_t levelIndexOffset = sizeof(IDENTIFIER) + sizeof(Header) + sizeof(Index);
+
+	if (levelCount > MAX_LEVELS || levelIndexOffset + levelCount * sizeof(LevelIndex) > bufferSize) {
+		printf("Invalid KTX2 level index!\n");
+		return false;
+	}
+
+	LevelIndex levels[MAX_LEVELS];
+	memcpy(levels, bytes + levelIndexOffset, levelCount * sizeof(LevelIndex));
+
+	Index index;
+	memcpy(&index, bytes + sizeof(IDENTIFIER) + sizeof(Header), sizeof(Index));
+
+	// only the block header is needed, it says whether alpha is premultiplied
+	DataFormatDescriptor descriptor = {};
+	size_t descriptorHeaderSize = offsetof(DataFormatDescriptor, samples);
+
+	if (index.dfdByteLength >= descriptorHeaderSize && index.dfdByteOffset <= bufferSize &&
+			descriptorHeaderSize <= bufferSize - index.dfdByteOffset)
+		memcpy(&descriptor, bytes + index.dfdByteOffset, descriptorHeaderSize);
+
+	size_t size = 0;
+
+	for (uint32_t i = 0; i < levelCount; i++) {
+		size_t levelSize =
+				imageFormatSize(format, levelDimension(header.pixelWidth, i), levelDimension(header.pixelHeight, i));
+
+		if (levels[i].byteLength != levelSize || levels[i].byteOffset > bufferSize ||
+				levels[i].byteLength > bufferSize - levels[i].byteOffset) {
+			printf("Invalid KTX2 level: %u!\n", i);
+			return false;
+		}
+
+		size += levelSize;
+	}
+
+	// the file keeps the smallest level first, images keep the largest
+	ImageStorage storage = ImagePool::singleton().allocate(size);
+	if (storage.data == nullptr) {
+		printf("KTX2 image is too large to load!\n");
+		return false;
+	}
+
+	size_t offset = 0;
+
+	for (uint32_t i = 0; i < levelCount; i++) {
+		memcpy(storage.data + offset, bytes + levels[i].byteOffset, levels[i].byteLength);
+		offset += levels[i].byteLength;
+	}
+
+	*image = Image(header.pixelWidth, header.pixelHeight, levelCount, format, storage);
+	image->colorSpaceSet(colorSpace);
+	image->premultipliedSet((descriptor.flags & DF_FLAG_ALPHA_PREMULTIPLIED) != 0);
+	return true;
+}
+
+bool ktx2Save(const char *filename, const Image *image) {
+	ImageFormat format = image->format();
+	uint32_t levelCount = image->mipLevels();
+
+	DataFormatDescriptor descriptor = descriptorCreate(image);
+	size_t levelIndexOffset = sizeof(IDENTIFIER) + sizeof(Header) + sizeof(Index);
+	size_t descriptorOffset = levelIndexOffset + levelCount * sizeof(LevelIndex);
+
+	Header header = {
+		.vkFormat = formatToVulkan(format, image->colorSpace()),
+		.typeSize = 1,
+		.pixelWidth = image->width(),
+		.pixelHeight = image->height(),
+		.pixelDepth = 0,
+		.layerCount = 0,
+		.faceCount = 1,
+		.levelCount = levelCount,
+		.supercompressionScheme = 0,
+	};
+
+	Index index = {
+		.dfdByteOffset = (uint32_t)descriptorOffset,
+		.dfdByteLength = descriptor.totalSize,
+		.kvdByteOffset = 0,
+		.kvdByteLength = 0,
+		.sgdByteOffset = 0,
+		.sgdByteLength = 0,
+	};
+
+	// level data follows the descriptor, smallest level first and every level aligned to a block
+	LevelIndex levels[MAX_LEVELS];
+	size_t alignment = formatBlockSize(format);
+	size_t offset = descriptorOffset + descriptor.totalSize;
+
+	for (uint32_t i = levelCount; i-- > 0;) {
+		offset = (offset + alignment - 1) / alignment * alignment;
+
+		levels[i].byteOffset = offset;
+		levels[i].byteLength = image->levelSize(i);
+		levels[i].uncompressedByteLength = image->levelSize(i);
+
+		offset += image->levelSize(i);
+	}
+
+	FILE *file = fopen(filename, "wb");
+	if (file == nullptr) {
+		perror("KTX2 file failed to open!\n");
+		return false;
+	}
+
+	fwrite(IDENTIFIER, sizeof(IDENTIFIER), 1, file);
+	fwrite(&header, sizeof(Header), 1, file);
+	fwrite(&index, sizeof(Index), 1, file);
+	fwrite(levels, sizeof(LevelIndex), levelCount, file);
+	fwrite(&descriptor, descriptor.totalSize, 1, file);
+
+	const uint8_t padding[16] = {};
+	size_t position = descriptorOffset + descriptor.totalSize;
+
+	for (uint32_t i = levelCount; i-- > 0;) {
+		fwrite(padding, levels[i].byteOffset - position, 1, file);
+		fwrite(image->data() + image->levelOffset(i), levels[i].byteLength, 1, file);
+		position = levels[i].byteOffset + levels[i].byteLength;
+	}
+
+	bool success = ferror(file) == 0;
+	fclose(file);
+	return success;
+}
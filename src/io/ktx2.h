@@ -0,0 +1,14 @@
+#ifndef KTX2_H
+#define KTX2_H
+
+#include <cstddef>
+
+class Image;
+
+// KTX2 containers of a single 2D image, with every mip level stored and no supercompression
+
+bool ktx2Check(const void *buffer, size_t bufferSize);
+bool ktx2LoadFromMemory(const void *buffer, size_t bufferSize, Image *image);
+bool ktx2Save(const char *filename, const Image *image);
+
+#endif // !KTX2_H
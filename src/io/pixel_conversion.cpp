@@ -0,0 +1,598 @@
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PIXEL_CONVERSION_X86
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PIXEL_CONVERSION_NEON
+#endif
+
+#include "core/job_system.h"
+
+#include "pixel_conversion.h"
+
+// pixels per job, smaller images are converted on the calling thread
+const size_t BATCH_SIZE = 1 << 16;
+
+// entries of the linear to sRGB table
+const uint32_t ENCODE_TABLE_SIZE = 1 << 16;
+
+typedef void (*ConvertFunction)(const uint8_t *src, uint8_t *dst, size_t count);
+
+typedef struct {
+	const char *name;
+	ConvertFunction grayToRGBA;
+	ConvertFunction grayAlphaToRGBA;
+	ConvertFunction rgbToRGBA;
+	ConvertFunction swizzleBGRA;
+	ConvertFunction premultiply;
+} Kernels;
+
+// x * y / 255 rounded to nearest, the same sequence the vector kernels use
+static uint8_t multiply255(uint32_t x, uint32_t y) {
+	uint32_t product = x * y + 128;
+	return (product + (product >> 8)) >> 8;
+}
+
+// scalar, also finishes the tail of every vector kernel
+
+static void grayToRGBAScalar(const uint8_t *src, uint8_t *dst, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		dst[i * 4 + 0] = src[i];
+		dst[i * 4 + 1] = src[i];
+		dst[i * 4 + 2] = src[i];
+		dst[i * 4 + 3] = 255;
+	}
+}
+
+static void grayAlphaToRGBAScalar(const uint8_t *src, uint8_t *dst, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		dst[i * 4 + 0] = src[i * 2];
+		dst[i * 4 + 1] = src[i * 2];
+		dst[i * 4 + 2] = src[i * 2];
+		dst[i * 4 + 3] = src[i * 2 + 1];
+	}
+}
+
+static void rgbToRGBAScalar(const uint8_t *src, uint8_t *dst, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		dst[i * 4 + 0] = src[i * 3 + 0];
+		dst[i * 4 + 1] = src[i * 3 + 1];
+		dst[i * 4 + 2] = src[i * 3 + 2];
+		dst[i * 4 + 3] = 255;
+	}
+}
+
+static void swizzleBGRAScalar(const uint8_t *src, uint8_t *dst, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		uint8_t red = src[i * 4 + 0];
+		uint8_t blue = src[i * 4 + 2];
+
+		dst[i * 4 + 0] = blue;
+		dst[i * 4 + 1] = src[i * 4 + 1];
+		dst[i * 4 + 2] = red;
+		dst[i * 4 + 3] = src[i * 4 + 3];
+	}
+}
+
+static void premultiplyScalar(const uint8_t *src, uint8_t *dst, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		uint8_t alpha = src[i * 4 + 3];
+
+		dst[i * 4 + 0] = multiply255(src[i * 4 + 0], alpha);
+		dst[i * 4 + 1] = multiply255(src[i * 4 + 1], alpha);
+		dst[i * 4 + 2] = multiply255(src[i * 4 + 2], alpha);
+		dst[i * 4 + 3] = alpha;
+	}
+}
+
+const Kernels SCALAR_KERNELS = {
+	.name = "scalar",
+	.grayToRGBA = grayToRGBAScalar,
+	.grayAlphaToRGBA = grayAlphaToRGBAScalar,
+	.rgbToRGBA = rgbToRGBAScalar,
+	.swizzleBGRA = swizzleBGRAScalar,
+	.premultiply = premultiplyScalar,
+};
+
+#ifdef PIXEL_CONVERSION_X86
+
+// compiled for the instruction set regardless of the build flags, only called once the CPU reports it
+#define TARGET_SSSE3 __attribute__((target("ssse3")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+TARGET_SSSE3 static void grayToRGBASSSE3(const uint8_t *src, uint8_t *dst, size_t count) {
+	const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+	const __m128i masks[4] = {
+		_mm_setr_epi8(0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1),
+		_mm_setr_epi8(4, 4, 4, -1, 5, 5, 5, -1, 6, 6, 6, -1, 7, 7, 7, -1),
+		_mm_setr_epi8(8, 8, 8, -1, 9, 9, 9, -1, 10, 10, 10, -1, 11, 11, 11, -1),
+		_mm_setr_epi8(12, 12, 12, -1, 13, 13, 13, -1, 14, 14, 14, -1, 15, 15, 15, -1),
+	};
+
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m128i gray = _mm_loadu_si128((const __m128i *)(src + i));
+
+		for (uint32_t j = 0; j < 4; j++) {
+			__m128i pixels = _mm_or_si128(_mm_shuffle_epi8(gray, masks[j]), alpha);
+			_mm_storeu_si128((__m128i *)(dst + (i + j * 4) * 4), pixels);
+		}
+	}
+
+	grayToRGBAScalar(src + i, dst + i * 4, count - i);
+}
+
+TARGET_SSSE3 static void grayAlphaToRGBASSSE3(const uint8_t *src, uint8_t *dst, size_t count) {
+	const __m128i lowMask = _mm_setr_epi8(0, 0, 0, 1, 2, 2, 2, 3, 4, 4, 4, 5, 6, 6, 6, 7);
+	const __m128i highMask = _mm_setr_epi8(8, 8, 8, 9, 10, 10, 10, 11, 12, 12, 12, 13, 14, 14, 14, 15);
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m128i grayAlpha = _mm_loadu_si128((const __m128i *)(src + i * 2));
+
+		_mm_storeu_si128((__m128i *)(dst + i * 4), _mm_shuffle_epi8(grayAlpha, lowMask));
+		_mm_storeu_si128((__m128i *)(dst + i * 4 + 16), _mm_shuffle_epi8(grayAlpha, highMask));
+	}
+
+	grayAlphaToRGBAScalar(src + i * 2, dst + i * 4, count - i);
+}
+
+TARGET_SSSE3 static void rgbToRGBASSSE3(const uint8_t *src, uint8_t *dst, size_t count) {
+	const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+	const __m128i mask = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+
+	// four pixels per load, the last four bytes belong to the next ones and must be in bounds
+	size_t i = 0;
+	for (; i + 6 <= count; i += 4) {
+		__m128i rgb = _mm_loadu_si128((const __m128i *)(src + i * 3));
+		_mm_storeu_si128((__m128i *)(dst + i * 4), _mm_or_si128(_mm_shuffle_epi8(rgb, mask), alpha));
+	}
+
+	rgbToRGBAScalar(src + i * 3, dst + i * 4, count - i);
+}
+
+TARGET_SSSE3 static void swizzleBGRASSSE3(const uint8_t *src, uint8_t *dst, size_t count) {
+	const __m128i mask = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i pixels = _mm_loadu_si128((const __m128i *)(src + i * 4));
+		_mm_storeu_si128((__m128i *)(dst + i * 4), _mm_shuffle_epi8(pixels, mask));
+	}
+
+	swizzleBGRAScalar(src + i * 4, dst + i * 4, count - i);
+}
+
+// two pixels widened to 16 bits, alpha multiplies itself by 255 so it comes out unchanged
+TARGET_SSSE3 static __m128i premultiplyWide(__m128i pixels) {
+	const __m128i colorMask = _mm_setr_epi16(-1, -1, -1, 0, -1, -1, -1, 0);
+	const __m128i alphaScale = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+	const __m128i rounding = _mm_set1_epi16(128);
+
+	__m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(pixels, 0xFF), 0xFF);
+	__m128i factor = _mm_or_si128(_mm_and_si128(alpha, colorMask), alphaScale);
+
+	__m128i product = _mm_add_epi16(_mm_mullo_epi16(pixels, factor), rounding);
+	return _mm_srli_epi16(_mm_add_epi16(product, _mm_srli_epi16(product, 8)), 8);
+}
+
+TARGET_SSSE3 static void premultiplySSSE3(const uint8_t *src, uint8_t *dst, size_t count) {
+	const __m128i zero = _mm_setzero_si128();
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i pixels = _mm_loadu_si128((const __m128i *)(src + i * 4));
+
+		__m128i low = premultiplyWide(_mm_unpacklo_epi8(pixels, zero));
+		__m128i high = premultiplyWide(_mm_unpackhi_epi8(pixels, zero));
+
+		_mm_storeu_si128((__m128i *)(dst + i * 4), _mm_packus_epi16(low, high));
+	}
+
+	premultiplyScalar(src + i * 4, dst + i * 4, count - i);
+}
+
+const Kernels SSSE3_KERNELS = {
+	.name = "ssse3",
+	.grayToRGBA = grayToRGBASSSE3,
+	.grayAlphaToRGBA = grayAlphaToRGBASSSE3,
+	.rgbToRGBA = rgbToRGBASSSE3,
+	.swizzleBGRA = swizzleBGRASSSE3,
+	.premultiply = premultiplySSSE3,
+};
+
+// AVX2 shuffles stay within 128 bit lanes, sources are broadcast or loaded into both lanes to match
+
+TARGET_AVX2 static void grayToRGBAAVX2(const uint8_t *src, uint8_t *dst, size_t count) {
+	const __m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+	const __m256i lowMask = _mm256_setr_epi8(0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1, 4, 4, 4, -1, 5, 5, 5,
+			-1, 6, 6, 6, -1, 7, 7, 7, -1);
+	const __m256i highMask = _mm256_setr_epi8(8, 8, 8, -1, 9, 9, 9, -1, 10, 10, 10, -1, 11, 11, 11, -1, 12, 12, 12, -1,
+			13, 13, 13, -1, 14, 14, 14, -1, 15, 15, 15, -1);
+
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m256i gray = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(src + i)));
+
+		__m256i low = _mm256_or_si256(_mm256_shuffle_epi8(gray, lowMask), alpha);
+		__m256i high = _mm256_or_si256(_mm256_shuffle_epi8(gray, highMask), alpha);
+
+		_mm256_storeu_si256((__m256i *)(dst + i * 4), low);
+		_mm256_storeu_si256((__m256i *)(dst + i * 4 + 32), high);
+	}
+
+	grayToRGBAScalar(src + i, dst + i * 4, count - i);
+}
+
+TARGET_AVX2 static void grayAlphaToRGBAAVX2(const uint8_t *src, uint8_t *dst, size_t count) {
+	const __m256i mask = _mm256_setr_epi8(0, 0, 0, 1, 2, 2, 2, 3, 4, 4, 4, 5, 6, 6, 6, 7, 8, 8, 8, 9, 10, 10, 10, 11,
+			12, 12, 12, 13, 14, 14, 14, 15);
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i grayAlpha = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(src + i * 2)));
+		_mm256_storeu_si256((__m256i *)(dst + i * 4), _mm256_shuffle_epi8(grayAlpha, mask));
+	}
+
+	grayAlphaToRGBAScalar(src + i * 2, dst + i * 4, count - i);
+}
+
+TARGET_AVX2 static void rgbToRGBAAVX2(const uint8_t *src, uint8_t *dst, size_t count) {
+	const __m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+	const __m256i mask = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1, 0, 1, 2, -1, 3, 4, 5,
+			-1, 6, 7, 8, -1, 9, 10, 11, -1);
+
+	// eight pixels from two overlapping loads, the second one reads four bytes past them
+	size_t i = 0;
+	for (; i + 10 <= count; i += 8) {
+		__m128i low = _mm_loadu_si128((const __m128i *)(src + i * 3));
+		__m128i high = _mm_loadu_si128((const __m128i *)(src + i * 3 + 12));
+		__m256i rgb = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+
+		_mm256_storeu_si256((__m256i *)(dst + i * 4), _mm256_or_si256(_mm256_shuffle_epi8(rgb, mask), alpha));
+	}
+
+	rgbToRGBAScalar(src + i * 3, dst + i * 4, count - i);
+}
+
+TARGET_AVX2 static void swizzleBGRAAVX2(const uint8_t *src, uint8_t *dst, size_t count) {
+	const __m256i mask = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15, 2, 1, 0, 3, 6, 5, 4, 7,
+			10, 9, 8, 11, 14, 13, 12, 15);
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i pixels = _mm256_loadu_si256((const __m256i *)(src + i * 4));
+		_mm256_storeu_si256((__m256i *)(dst + i * 4), _mm256_shuffle_epi8(pixels, mask));
+	}
+
+	swizzleBGRAScalar(src + i * 4, dst + i * 4, count - i);
+}
+
+TARGET_AVX2 static __m256i premultiplyWideAVX2(__m256i pixels) {
+	const __m256i colorMask = _mm256_setr_epi16(-1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1, 0);
+	const __m256i alphaScale = _mm256_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255);
+	const __m256i rounding = _mm256_set1_epi16(128);
+
+	__m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(pixels, 0xFF), 0xFF);
+	__m256i factor = _mm256_or_si256(_mm256_and_si256(alpha, colorMask), alphaScale);
+
+	__m256i product = _mm256_add_epi16(_mm256_mullo_epi16(pixels, factor), rounding);
+	return _mm256_srli_epi16(_mm256_add_epi16(product, _mm256_srli_epi16(product, 8)), 8);
+}
+
+TARGET_AVX2 static void premultiplyAVX2(const uint8_t *src, uint8_t *dst, size_t count) {
+	const __m256i zero = _mm256_setzero_si256();
+
+	// unpacking and packing both work per lane, so the pixel order survives
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i pixels = _mm256_loadu_si256((const __m256i *)(src + i * 4));
+
+		__m256i low = premultiplyWideAVX2(_mm256_unpacklo_epi8(pixels, zero));
+		__m256i high = premultiplyWideAVX2(_mm256_unpackhi_epi8(pixels, zero));
+
+		_mm256_storeu_si256((__m256i *)(dst + i * 4), _mm256_packus_epi16(low, high));
+	}
+
+	premultiplyScalar(src + i * 4, dst + i * 4, count - i);
+}
+
+const Kernels AVX2_KERNELS = {
+	.name = "avx2",
+	.grayToRGBA = grayToRGBAAVX2,
+	.grayAlphaToRGBA = grayAlphaToRGBAAVX2,
+	.rgbToRGBA = rgbToRGBAAVX2,
+	.swizzleBGRA = swizzleBGRAAVX2,
+	.premultiply = premultiplyAVX2,
+};
+
+#endif // PIXEL_CONVERSION_X86
+
+#ifdef PIXEL_CONVERSION_NEON
+
+// interleaved loads and stores do the shuffling, 16 pixels at a time
+
+static void grayToRGBANEON(const uint8_t *src, uint8_t *dst, size_t count) {
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		uint8x16_t gray = vld1q_u8(src + i);
+
+		uint8x16x4_t pixels;
+		pixels.val[0] = gray;
+		pixels.val[1] = gray;
+		pixels.val[2] = gray;
+		pixels.val[3] = vdupq_n_u8(255);
+
+		vst4q_u8(dst + i * 4, pixels);
+	}
+
+	grayToRGBAScalar(src + i, dst + i * 4, count - i);
+}
+
+static void grayAlphaToRGBANEON(const uint8_t *src, uint8_t *dst, size_t count) {
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		uint8x16x2_t grayAlpha = vld2q_u8(src + i * 2);
+
+		uint8x16x4_t pixels;
+		pixels.val[0] = grayAlpha.val[0];
+		pixels.val[1] = grayAlpha.val[0];
+		pixels.val[2] = grayAlpha.val[0];
+		pixels.val[3] = grayAlpha.val[1];
+
+		vst4q_u8(dst + i * 4, pixels);
+	}
+
+	grayAlphaToRGBAScalar(src + i * 2, dst + i * 4, count - i);
+}
+
+static void rgbToRGBANEON(const uint8_t *src, uint8_t *dst, size_t count) {
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		uint8x16x3_t rgb = vld3q_u8(src + i * 3);
+
+		uint8x16x4_t pixels;
+		pixels.val[0] = rgb.val[0];
+		pixels.val[1] = rgb.val[1];
+		pixels.val[2] = rgb.val[2];
+		pixels.val[3] = vdupq_n_u8(255);
+
+		vst4q_u8(dst + i * 4, pixels);
+	}
+
+	rgbToRGBAScalar(src + i * 3, dst + i * 4, count - i);
+}
+
+static void swizzleBGRANEON(const uint8_t *src, uint8_t *dst, size_t count) {
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		uint8x16x4_t pixels = vld4q_u8(src + i * 4);
+
+		uint8x16_t red = pixels.val[0];
+		pixels.val[0] = pixels.val[2];
+		pixels.val[2] = red;
+
+		vst4q_u8(dst + i * 4, pixels);
+	}
+
+	swizzleBGRAScalar(src + i * 4, dst + i * 4, count - i);
+}
+
+// (x + ((x + 128) >> 8) + 128) >> 8, narrowed back to 8 bits
+static uint8x16_t multiply255NEON(uint8x16_t color, uint8x16_t alpha) {
+	uint16x8_t low = vmull_u8(vget_low_u8(color), vget_low_u8(alpha));
+	uint16x8_t high = vmull_u8(vget_high_u8(color), vget_high_u8(alpha));
+
+	return vcombine_u8(vraddhn_u16(low, vrshrq_n_u16(low, 8)), vraddhn_u16(high, vrshrq_n_u16(high, 8)));
+}
+
+static void premultiplyNEON(const uint8_t *src, uint8_t *dst, size_t count) {
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		uint8x16x4_t pixels = vld4q_u8(src + i * 4);
+
+		for (uint32_t c = 0; c < 3; c++)
+			pixels.val[c] = multiply255NEON(pixels.val[c], pixels.val[3]);
+
+		vst4q_u8(dst + i * 4, pixels);
+	}
+
+	premultiplyScalar(src + i * 4, dst + i * 4, count - i);
+}
+
+const Kernels NEON_KERNELS = {
+	.name = "neon",
+	.grayToRGBA = grayToRGBANEON,
+	.grayAlphaToRGBA = grayAlphaToRGBANEON,
+	.rgbToRGBA = rgbToRGBANEON,
+	.swizzleBGRA = swizzleBGRANEON,
+	.premultiply = premultiplyNEON,
+};
+
+#endif // PIXEL_CONVERSION_NEON
+
+static const Kernels &kernels() {
+	static const Kernels *selected = []() {
+#if defined(PIXEL_CONVERSION_X86)
+		__builtin_cpu_init();
+
+		if (__builtin_cpu_supports("avx2"))
+			return &AVX2_KERNELS;
+
+		if (__builtin_cpu_supports("ssse3"))
+			return &SSSE3_KERNELS;
+#elif defined(PIXEL_CONVERSION_NEON)
+		return &NEON_KERNELS;
+#endif
+		return &SCALAR_KERNELS;
+	}();
+
+	return *selected;
+}
+
+// splits the pixels into batches for the job system, the function gets the first pixel and a count
+template <typename F>
+static void batchesRun(size_t count, const F &function) {
+	if (count <= BATCH_SIZE) {
+		function(0, count);
+		return;
+	}
+
+	uint32_t batchCount = (count + BATCH_SIZE - 1) / BATCH_SIZE;
+
+	JobSystem::singleton().parallelFor(batchCount, 1, [&](uint32_t begin, uint32_t end) {
+		size_t first = begin * BATCH_SIZE;
+		size_t last = end * BATCH_SIZE < count ? end * BATCH_SIZE : count;
+
+		function(first, last - first);
+	});
+}
+
+static void convert(ConvertFunction function, const uint8_t *src, uint32_t srcSize, uint8_t *dst, uint32_t dstSize,
+		size_t count) {
+	batchesRun(count, [=](size_t first, size_t batchCount) {
+		function(src + first * srcSize, dst + first * dstSize, batchCount);
+	});
+}
+
+const char *pixelConversionTarget() {
+	return kernels().name;
+}
+
+void pixelsGrayToRGBA(const uint8_t *src, uint8_t *dst, size_t count) {
+	convert(kernels().grayToRGBA, src, 1, dst, 4, count);
+}
+
+void pixelsGrayAlphaToRGBA(const uint8_t *src, uint8_t *dst, size_t count) {
+	convert(kernels().grayAlphaToRGBA, src, 2, dst, 4, count);
+}
+
+void pixelsRGBToRGBA(const uint8_t *src, uint8_t *dst, size_t count) {
+	convert(kernels().rgbToRGBA, src, 3, dst, 4, count);
+}
+
+void pixelsToRGBA(const uint8_t *src, uint32_t channelCount, uint8_t *dst, size_t count) {
+	switch (channelCount) {
+		case 1:
+			pixelsGrayToRGBA(src, dst, count);
+			break;
+		case 2:
+			pixelsGrayAlphaToRGBA(src, dst, count);
+			break;
+		case 3:
+			pixelsRGBToRGBA(src, dst, count);
+			break;
+		default:
+			if (src != dst)
+				memcpy(dst, src, count * 4);
+			break;
+	}
+}
+
+void pixelsSwizzleBGRA(const uint8_t *src, uint8_t *dst, size_t count) {
+	convert(kernels().swizzleBGRA, src, 4, dst, 4, count);
+}
+
+void pixelsPremultiply(const uint8_t *src, uint8_t *dst, size_t count) {
+	convert(kernels().premultiply, src, 4, dst, 4, count);
+}
+
+static float srgbDecode(float value) {
+	return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static float srgbEncode(float value) {
+	return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+// every 8 bit sRGB value decoded
+static const float *decodeTable() {
+	static const float *table = []() {
+		static float values[256];
+
+		for (uint32_t i = 0; i < 256; i++)
+			values[i] = srgbDecode(i / 255.0f);
+
+		return values;
+	}();
+
+	return table;
+}
+
+// linear values quantized to 16 bits, fine enough that dark values still round to the right code
+static const uint8_t *encodeTable() {
+	static const uint8_t *table = []() {
+		static uint8_t values[ENCODE_TABLE_SIZE];
+
+		for (uint32_t i = 0; i < ENCODE_TABLE_SIZE; i++)
+			values[i] = srgbEncode(i / float(ENCODE_TABLE_SIZE - 1)) * 255.0f + 0.5f;
+
+		return values;
+	}();
+
+	return table;
+}
+
+static uint8_t linearEncode(const uint8_t *table, float value) {
+	value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+	return table[(uint32_t)(value * (ENCODE_TABLE_SIZE - 1) + 0.5f)];
+}
+
+void pixelsPremultiplySRGB(const uint8_t *src, uint8_t *dst, size_t count) {
+	const float *decode = decodeTable();
+	const uint8_t *encode = encodeTable();
+
+	batchesRun(count, [=](size_t first, size_t batchCount) {
+		for (size_t i = first; i < first + batchCount; i++) {
+			uint8_t alpha = src[i * 4 + 3];
+
+			// opaque pixels are the common case and stay as they are
+			if (alpha == 255) {
+				if (src != dst)
+					memcpy(dst + i * 4, src + i * 4, 4);
+
+				continue;
+			}
+
+			float scale = alpha / 255.0f;
+
+			dst[i * 4 + 0] = linearEncode(encode, decode[src[i * 4 + 0]] * scale);
+			dst[i * 4 + 1] = linearEncode(encode, decode[src[i * 4 + 1]] * scale);
+			dst[i * 4 + 2] = linearEncode(encode, decode[src[i * 4 + 2]] * scale);
+			dst[i * 4 + 3] = alpha;
+		}
+	});
+}
+
+void pixelsSRGBToLinear(const uint8_t *src, float *dst, size_t count) {
+	const float *decode = decodeTable();
+
+	batchesRun(count, [=](size_t first, size_t batchCount) {
+		for (size_t i = first; i < first + batchCount; i++) {
+			dst[i * 4 + 0] = decode[src[i * 4 + 0]];
+			dst[i * 4 + 1] = decode[src[i * 4 + 1]];
+			dst[i * 4 + 2] = decode[src[i * 4 + 2]];
+			dst[i * 4 + 3] = src[i * 4 + 3] / 255.0f;
+		}
+	});
+}
+
+void pixelsLinearToSRGB(const float *src, uint8_t *dst, size_t count) {
+	const uint8_t *encode = encodeTable();
+
+	batchesRun(count, [=](size_t first, size_t batchCount) {
+		for (size_t i = first; i < first + batchCount; i++) {
+			float alpha = src[i * 4 + 3] < 0.0f ? 0.0f : (src[i * 4 + 3] > 1.0f ? 1.0f : src[i * 4 + 3]);
+
+			dst[i * 4 + 0] = linearEncode(encode, src[i * 4 + 0]);
+			dst[i * 4 + 1] = linearEncode(encode, src[i * 4 + 1]);
+			dst[i * 4 + 2] = linearEncode(encode, src[i * 4 + 2]);
+			dst[i * 4 + 3] = alpha * 255.0f + 0.5f;
+		}
+	});
+}
@@ -0,0 +1,32 @@
+#ifndef PIXEL_CONVERSION_H
+#define PIXEL_CONVERSION_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Pixel format conversions for loaded images. The kernels are picked once at runtime from
+// the best the CPU supports (AVX2, SSSE3, NEON or plain C) and large images are split
+// across the job system. Source and destination may be the same buffer where the pixel
+// size does not change.
+
+// name of the kernels in use, e.g. "avx2"
+const char *pixelConversionTarget();
+
+void pixelsGrayToRGBA(const uint8_t *src, uint8_t *dst, size_t count);
+void pixelsGrayAlphaToRGBA(const uint8_t *src, uint8_t *dst, size_t count);
+void pixelsRGBToRGBA(const uint8_t *src, uint8_t *dst, size_t count);
+// 1 to 4 channels, four are copied as they are
+void pixelsToRGBA(const uint8_t *src, uint32_t channelCount, uint8_t *dst, size_t count);
+
+// swaps red and blue, converts RGBA to BGRA and back
+void pixelsSwizzleBGRA(const uint8_t *src, uint8_t *dst, size_t count);
+// multiplies the color channels of RGBA pixels by their alpha, rounded to nearest
+void pixelsPremultiply(const uint8_t *src, uint8_t *dst, size_t count);
+// the same for sRGB encoded pixels, the multiply happens on decoded values and the result is encoded again
+void pixelsPremultiplySRGB(const uint8_t *src, uint8_t *dst, size_t count);
+// decodes the color channels of sRGB encoded RGBA pixels through a table, alpha is scaled to 0..1
+void pixelsSRGBToLinear(const uint8_t *src, float *dst, size_t count);
+// encodes linear RGBA pixels back to sRGB, values are clamped to 0..1
+void pixelsLinearToSRGB(const float *src, uint8_t *dst, size_t count);
+
+#endif // !PIXEL_CONVERSION_H
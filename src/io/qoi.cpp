@@ -0,0 +1,267 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "image.h"
+#include "image_pool.h"
+#include "qoi.h"
+
+const uint8_t MAGIC[4] = { 'q', 'o', 'i', 'f' };
+const size_t HEADER_SIZE = 14;
+const uint8_t END_MARKER[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+
+// the reference limit, keeps a corrupt header from asking for absurd amounts of memory
+const size_t MAX_PIXELS = 400000000;
+
+const uint8_t OP_INDEX = 0x00;
+const uint8_t OP_DIFF = 0x40;
+const uint8_t OP_LUMA = 0x80;
+const uint8_t OP_RUN = 0xC0;
+const uint8_t OP_RGB = 0xFE;
+const uint8_t OP_RGBA = 0xFF;
+const uint8_t OP_MASK = 0xC0;
+
+// runs of one to 62 pixels, the two codes above are taken by OP_RGB and OP_RGBA
+const uint32_t MAX_RUN = 62;
+
+// the header stores sRGB color with linear alpha as 0 and everything linear as 1
+const uint8_t COLORSPACE_SRGB = 0;
+const uint8_t COLORSPACE_LINEAR = 1;
+
+typedef struct {
+	uint8_t r, g, b, a;
+} Pixel;
+
+static uint32_t hash(Pixel pixel) {
+	return (pixel.r * 3 + pixel.g * 5 + pixel.b * 7 + pixel.a * 11) % 64;
+}
+
+static bool pixelEqual(Pixel a, Pixel b) {
+	return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+static uint32_t readBigEndian(const uint8_t *bytes) {
+	return (uint32_t)bytes[0] << 24 | (uint32_t)bytes[1] << 16 | (uint32_t)bytes[2] << 8 | bytes[3];
+}
+
+static void writeBigEndian(uint8_t *bytes, uint32_t value) {
+	bytes[0] = value >> 24;
+	bytes[1] = value >> 16;
+	bytes[2] = value >> 8;
+	bytes[3] = value;
+}
+
+bool qoiCheck(const void *buffer, size_t bufferSize) {
+	return bufferSize >= sizeof(MAGIC) && memcmp(buffer, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+bool qoiLoadFromMemory(const void *buffer, size_t bufferSize, Image *image) {
+	const uint8_t *bytes = (const uint8_t *)buffer;
+
+	if (!qoiCheck(buffer, bufferSize) || bufferSize < HEADER_SIZE + sizeof(END_MARKER)) {
+		printf("Invalid QOI file!\n");
+		return false;
+	}
+
+	uint32_t width = readBigEndian(bytes + 4);
+	uint32_t height = readBigEndian(bytes + 8);
+	uint8_t colorSpace = bytes[13];
+
+	size_t pixelCount = (size_t)width * height;
+	if (width == 0 || height == 0 || pixelCount > MAX_PIXELS) {
+		printf("Invalid QOI size: %ux%u!\n", width, height);
+		return false;
+	}
+
+	ImageStorage storage = ImagePool::singleton().allocate(pixelCount * 4);
+	if (storage.data == nullptr) {
+		printf("QOI image is too large to load!\n");
+		return false;
+	}
+
+	// chunks are at most five bytes and the end marker is eight, so a chunk starting before it never reads past
+	const uint8_t *input = bytes + HEADER_SIZE;
+	const uint8_t *inputEnd = bytes + bufferSize - sizeof(END_MARKER);
+
+	// pixels are written whole, four bytes at a time
+	uint8_t *output = storage.data;
+	uint8_t *outputEnd = storage.data + pixelCount * 4;
+
+	Pixel index[64] = {};
+	Pixel pixel = { 0, 0, 0, 255 };
+
+	while (output < outputEnd) {
+		if (input >= inputEnd) {
+			printf("Truncated QOI data!\n");
+			imageStorageRelease(&storage);
+			return false;
+		}
+
+		uint8_t op = *input++;
+		uint32_t count = 1;
+
+		if (op == OP_RGB) {
+			pixel.r = input[0];
+			pixel.g = input[1];
+			pixel.b = input[2];
+			input += 3;
+		} else if (op == OP_RGBA) {
+			pixel.r = input[0];
+			pixel.g = input[1];
+			pixel.b = input[2];
+			pixel.a = input[3];
+			input += 4;
+		} else if ((op & OP_MASK) == OP_INDEX) {
+			pixel = index[op];
+		} else if ((op & OP_MASK) == OP_DIFF) {
+			pixel.r += ((op >> 4) & 0x03) - 2;
+			pixel.g += ((op >> 2) & 0x03) - 2;
+			pixel.b += (op & 0x03) - 2;
+		} else if ((op & OP_MASK) == OP_LUMA) {
+			uint8_t second = *input++;
+			int greenDiff = (op & 0x3F) - 32;
+
+			pixel.r += greenDiff - 8 + ((second >> 4) & 0x0F);
+			pixel.g += greenDiff;
+			pixel.b += greenDiff - 8 + (second & 0x0F);
+		} else {
+			count = (op & 0x3F) + 1;
+
+			// the run may not run past the image
+			size_t remaining = (outputEnd - output) / 4;
+			if (count > remaining)
+				count = remaining;
+		}
+
+		index[hash(pixel)] = pixel;
+
+		// a plain fill, the compiler turns long runs into vector stores
+		uint32_t value;
+		memcpy(&value, &pixel, 4);
+
+		for (uint32_t i = 0; i < count; i++)
+			memcpy(output + i * 4, &value, 4);
+
+		output += count * 4;
+	}
+
+	*image = Image(width, height, 1, IMAGE_FORMAT_RGBA8, storage);
+	image->colorSpaceSet(colorSpace == COLORSPACE_LINEAR ? IMAGE_COLOR_SPACE_LINEAR : IMAGE_COLOR_SPACE_SRGB);
+	return true;
+}
+
+bool qoiSave(const char *filename, const Image *image) {
+	if (image->format() != IMAGE_FORMAT_RGBA8 || image->isPremultiplied()) {
+		printf("QOI stores uncompressed images with straight alpha only!\n");
+		return false;
+	}
+
+	uint32_t width = image->width();
+	uint32_t height = image->height();
+	size_t pixelCount = (size_t)width * height;
+
+	// every pixel costs five bytes at worst
+	uint8_t *bytes = (uint8_t *)malloc(HEADER_SIZE + pixelCount * 5 + sizeof(END_MARKER));
+	if (bytes == nullptr)
+		return false;
+
+	const Pixel *pixels = (const Pixel *)image->data();
+
+	// three channels only tells readers alpha is always opaque, the chunks are the same either way
+	bool opaque = true;
+	for (size_t i = 0; i < pixelCount && opaque; i++)
+		opaque = pixels[i].a == 255;
+
+	memcpy(bytes, MAGIC, sizeof(MAGIC));
+	writeBigEndian(bytes + 4, width);
+	writeBigEndian(bytes + 8, height);
+	bytes[12] = opaque ? 3 : 4;
+	bytes[13] = image->colorSpace() == IMAGE_COLOR_SPACE_LINEAR ? COLORSPACE_LINEAR : COLORSPACE_SRGB;
+
+	uint8_t *output = bytes + HEADER_SIZE;
+
+	Pixel index[64] = {};
+	Pixel previous = { 0, 0, 0, 255 };
+	uint32_t run = 0;
+
+	for (size_t i = 0; i < pixelCount; i++) {
+		Pixel pixel = pixels[i];
+
+		if (pixelEqual(pixel, previous)) {
+			run++;
+
+			if (run == MAX_RUN || i == pixelCount - 1) {
+				*output++ = OP_RUN | (run - 1);
+				run = 0;
+			}
+
+			continue;
+		}
+
+		if (run > 0) {
+			*output++ = OP_RUN | (run - 1);
+			run = 0;
+		}
+
+		uint32_t position = hash(pixel);
+
+		if (pixelEqual(index[position], pixel)) {
+			*output++ = OP_INDEX | position;
+			previous = pixel;
+			continue;
+		}
+
+		index[position] = pixel;
+
+		if (pixel.a != previous.a) {
+			*output++ = OP_RGBA;
+			*output++ = pixel.r;
+			*output++ = pixel.g;
+			*output++ = pixel.b;
+			*output++ = pixel.a;
+			previous = pixel;
+			continue;
+		}
+
+		int8_t redDiff = pixel.r - previous.r;
+		int8_t greenDiff = pixel.g - previous.g;
+		int8_t blueDiff = pixel.b - previous.b;
+
+		int8_t redGreenDiff = redDiff - greenDiff;
+		int8_t blueGreenDiff = blueDiff - greenDiff;
+
+		if (redDiff >= -2 && redDiff <= 1 && greenDiff >= -2 && greenDiff <= 1 && blueDiff >= -2 && blueDiff <= 1) {
+			*output++ = OP_DIFF | (redDiff + 2) << 4 | (greenDiff + 2) << 2 | (blueDiff + 2);
+		} else if (greenDiff >= -32 && greenDiff <= 31 && redGreenDiff >= -8 && redGreenDiff <= 7 &&
+				blueGreenDiff >= -8 && blueGreenDiff <= 7) {
+			*output++ = OP_LUMA | (greenDiff + 32);
+			*output++ = (redGreenDiff + 8) << 4 | (blueGreenDiff + 8);
+		} else {
+			*output++ = OP_RGB;
+			*output++ = pixel.r;
+			*output++ = pixel.g;
+			*output++ = pixel.b;
+		}
+
+		previous = pixel;
+	}
+
+	memcpy(output, END_MARKER, sizeof(END_MARKER));
+	output += sizeof(END_MARKER);
+
+	FILE *file = fopen(filename, "wb");
+	if (file == nullptr) {
+		perror("QOI file failed to open!\n");
+		free(bytes);
+		return false;
+	}
+
+	fwrite(bytes, output - bytes, 1, file);
+	free(bytes);
+
+	bool success = ferror(file) == 0;
+	success = fclose(file) == 0 && success;
+	return success;
+}
@@ -0,0 +1,16 @@
+#ifndef QOI_H
+#define QOI_H
+
+#include <cstddef>
+
+class Image;
+
+// QOI images, lossless RGBA with straight alpha that decodes several times faster than PNG
+
+bool qoiCheck(const void *buffer, size_t bufferSize);
+// decodes straight into pool memory, the image keeps straight alpha
+bool qoiLoadFromMemory(const void *buffer, size_t bufferSize, Image *image);
+// uncompressed images with straight alpha only, premultiplied color cannot be stored losslessly
+bool qoiSave(const char *filename, const Image *image);
+
+#endif // !QOI_H
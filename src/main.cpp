@@ -1,17 +1,27 @@
 #include <cstdint>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_error.h>
 #include <SDL2/SDL_events.h>
+#include <SDL2/SDL_keycode.h>
 #include <SDL2/SDL_log.h>
 #include <SDL2/SDL_stdinc.h>
 #include <SDL2/SDL_timer.h>
 #include <SDL2/SDL_video.h>
 #include <SDL2/SDL_vulkan.h>
 
-#include "io/image_loader.h"
+#include "core/job_system.h"
+#include "io/file_watcher.h"
+#include "io/image.h"
+#include "io/image_cache.h"
+#include "io/image_importer.h"
 #include "rendering/rendering_server.h"
 
 #define SDL_SUCCESS 0
@@ -21,6 +31,106 @@ const int HEIGHT = 720;
 
 const double TIMESTEP = 1.0 / 30.0;
 
+// longest frame the simulation catches up on, e.g. after waking up from idle
+const double MAX_FRAME_TIME = 0.25;
+
+// pushed by import workers when finished images are waiting
+static uint32_t importEvent = (uint32_t)-1;
+
+// every imported image, browsed with the arrow keys; the renderer evicts the ones not looked at when memory runs low
+static std::vector<uint32_t> textures;
+static size_t shownTexture = 0;
+// by the path they were imported from, a file imported again reloads its texture
+static std::unordered_map<std::string, uint32_t> pathTextures;
+
+static void textureShow(size_t index) {
+	shownTexture = index;
+	RS::singleton().spriteTextureSet(textures[index]);
+}
+
+static void importsCollect(TextureFilter textureFilter) {
+	ImageImporter &importer = ImageImporter::singleton();
+
+	std::string path;
+	Image image;
+	uint64_t pixelHash;
+	size_t first = textures.size();
+
+	while (importer.poll(&path, &image, &pixelHash)) {
+		std::unordered_map<std::string, uint32_t>::iterator known = pathTextures.find(path);
+
+		if (known != pathTextures.end()) {
+			RS::singleton().textureUpdate(known->second, std::move(image), pixelHash);
+			printf("Reloaded %s\n", path.c_str());
+			continue;
+		}
+
+		// duplicates get an id of their own, so each can be reloaded on its own, but share the texture
+		uint32_t texture = RS::singleton().textureCreate(std::move(image), textureFilter, pixelHash);
+		textures.push_back(texture);
+		pathTextures[path] = texture;
+		FileWatcher::singleton().watch(path);
+	}
+
+	if (textures.size() == first)
+		return;
+
+	// the newest image goes on screen, only it gets uploaded right away
+	textureShow(textures.size() - 1);
+
+	ImportProgress progress = importer.progress();
+	printf("Imported %u/%u images", progress.finished - progress.failed, progress.queued);
+
+	if (progress.failed > 0)
+		printf(", %u failed", progress.failed);
+
+	printf("\n");
+}
+
+static bool handleEvent(SDL_Window *window, const SDL_Event &event, TextureFilter textureFilter) {
+	if (event.type == SDL_QUIT)
+		return false;
+
+	if (event.type == SDL_WINDOWEVENT) {
+		int width, height;
+
+		switch (event.window.event) {
+			case SDL_WINDOWEVENT_SIZE_CHANGED:
+			case SDL_WINDOWEVENT_RESTORED:
+				SDL_Vulkan_GetDrawableSize(window, &width, &height);
+				RS::singleton().windowResize(width, height);
+				break;
+			case SDL_WINDOWEVENT_MINIMIZED:
+				RS::singleton().windowResize(0, 0);
+				break;
+			case SDL_WINDOWEVENT_EXPOSED:
+				RS::singleton().redrawRequest();
+				break;
+			default:
+				break;
+		}
+	}
+
+	if (event.type == SDL_KEYDOWN && !textures.empty()) {
+		if (event.key.keysym.sym == SDLK_LEFT)
+			textureShow((shownTexture + textures.size() - 1) % textures.size());
+
+		if (event.key.keysym.sym == SDLK_RIGHT)
+			textureShow((shownTexture + 1) % textures.size());
+	}
+
+	// files and directories are decoded on workers, the window keeps running meanwhile
+	if (event.type == SDL_DROPFILE) {
+		ImageImporter::singleton().queue(event.drop.file);
+		SDL_free(event.drop.file);
+	}
+
+	if (event.type == importEvent)
+		importsCollect(textureFilter);
+
+	return true;
+}
+
 int main(int argc, char *argv[]) {
 	// Force X11; Wayland is a buggy mess in SDL 2.0
 	SDL_SetHint(SDL_HINT_VIDEODRIVER, "x11");
@@ -30,11 +140,14 @@ int main(int argc, char *argv[]) {
 		return EXIT_FAILURE;
 	}
 
+	JobSystem::singleton().initialize(0);
+
 	uint32_t flags = SDL_WINDOW_RESIZABLE | SDL_WINDOW_VULKAN;
 	SDL_Window *window = SDL_CreateWindow("App", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, WIDTH, HEIGHT, flags);
 
 	if (window == nullptr) {
 		SDL_LogError(SDL_LOG_CATEGORY_ERROR, "%s", SDL_GetError());
+		JobSystem::singleton().finalize();
 		SDL_Quit();
 		return EXIT_FAILURE;
 	}
@@ -46,62 +159,116 @@ int main(int argc, char *argv[]) {
 	SDL_Vulkan_GetInstanceExtensions(window, &extensionCount, extensions);
 
 	RS::singleton().initialize(argc, argv, extensions, extensionCount);
+
+	// dropped images are treated as pixel art unless asked otherwise
+	TextureFilter textureFilter = TEXTURE_FILTER_NEAREST;
+	bool imageCache = true;
+	bool hotReload = true;
+
+	for (int i = 0; i < argc; i++) {
+		if (strcmp("--trilinear", argv[i]) == 0)
+			textureFilter = TEXTURE_FILTER_TRILINEAR;
+
+		if (strcmp("--no-image-cache", argv[i]) == 0)
+			imageCache = false;
+
+		if (strcmp("--no-hot-reload", argv[i]) == 0)
+			hotReload = false;
+	}
+
+	if (imageCache)
+		ImageCache::singleton().initialize(nullptr);
+
+	if (hotReload)
+		FileWatcher::singleton().initialize();
+
+	importEvent = SDL_RegisterEvents(1);
+	ImageImporter::singleton().notifySet([]() {
+		SDL_Event event = {};
+		event.type = importEvent;
+		SDL_PushEvent(&event);
+	});
+
 	VkInstance instance = RS::singleton().vulkanInstance();
 
 	VkSurfaceKHR surface;
 	SDL_Vulkan_CreateSurface(window, instance, &surface);
 	RS::singleton().windowCreate(surface, WIDTH, HEIGHT);
 
+	SDL_DisplayMode displayMode;
+	if (SDL_GetWindowDisplayMode(window, &displayMode) == SDL_SUCCESS && displayMode.refresh_rate > 0)
+		RS::singleton().refreshRateSet((float)displayMode.refresh_rate);
+
 	double accumulator = 0.0;
 	double time = 0.0;
 
+	// simulation state, copied out to the renderer after every step
+	SceneSnapshot state = {};
+
 	uint64_t lastTick, currentTick;
 	lastTick = SDL_GetPerformanceCounter();
 
+	// a failed draw (e.g. while minimized) must not spin the loop until the next event
+	bool drawn = true;
+
 	bool quit = false;
 	while (!quit) {
 		SDL_Event event;
-		while (SDL_PollEvent(&event)) {
-			if (event.type == SDL_QUIT)
-				quit = true;
-
-			if (event.type == SDL_WINDOWEVENT_RESIZED) {
-				int width, height;
-				SDL_Vulkan_GetDrawableSize(window, &width, &height);
-				RS::singleton().windowResize(width, height);
-			}
+		int hasEvent = 0;
 
-			if (event.type == SDL_DROPFILE) {
-				char *filename = event.drop.file;
-				Image *image = imageLoad(filename);
+		if (drawn && RS::singleton().isRedrawPending()) {
+			// input is read after the wait, as close to the frame as possible
+			RS::singleton().frameWait();
+			hasEvent = SDL_PollEvent(&event);
+		} else {
+			// nothing to draw, sleep until an event arrives or the next simulation step is due
+			int timeout = (int)((TIMESTEP - accumulator) * 1000.0) + 1;
+			hasEvent = SDL_WaitEventTimeout(&event, timeout);
+		}
 
-				if (image != nullptr)
-					RS::singleton().spriteCreate(image);
+		while (hasEvent) {
+			if (!handleEvent(window, event, textureFilter))
+				quit = true;
 
-				SDL_free(filename);
-			}
+			hasEvent = SDL_PollEvent(&event);
 		}
 
+		// saved files are decoded again on workers and come back through the importer
+		std::string changed;
+		while (FileWatcher::singleton().poll(&changed))
+			ImageImporter::singleton().queue(changed.c_str());
+
 		currentTick = SDL_GetPerformanceCounter();
 		double frameTime = (double)(currentTick - lastTick) / (double)SDL_GetPerformanceFrequency();
 		lastTick = currentTick;
 
+		if (frameTime > MAX_FRAME_TIME)
+			frameTime = MAX_FRAME_TIME;
+
 		accumulator += frameTime;
 
 		while (accumulator >= TIMESTEP) {
-			// game logic
+			// game logic, updates state
 			// printf("Frame time: %lf\n", frameTime);
 			// printf("Time: %lf\n", time);
 
+			RS::singleton().snapshotPublish(state);
+
 			accumulator -= TIMESTEP;
 			time += TIMESTEP;
 		}
 
-		// const double fraction = accumulator / TIMESTEP;
+		const double fraction = accumulator / TIMESTEP;
+		RS::singleton().snapshotInterpolate((float)fraction);
 
-		RS::singleton().draw();
+		drawn = RS::singleton().draw();
 	}
 
+	ImageImporter::singleton().cancel();
+	FileWatcher::singleton().finalize();
+	RS::singleton().finalize();
+	JobSystem::singleton().finalize();
+
 	SDL_DestroyWindow(window);
 	SDL_Quit();
 	return EXIT_SUCCESS;
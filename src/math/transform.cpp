@@ -0,0 +1,20 @@
+#include <cmath>
+
+#include "transform.h"
+
+const float PI = 3.14159265358979f;
+
+static float lerp(float from, float to, float weight) {
+	return from + (to - from) * weight;
+}
+
+Transform transformInterpolate(const Transform &from, const Transform &to, float weight) {
+	float rotation = std::remainder(to.rotation - from.rotation, 2.0f * PI);
+
+	Transform transform;
+	transform.x = lerp(from.x, to.x, weight);
+	transform.y = lerp(from.y, to.y, weight);
+	transform.rotation = from.rotation + rotation * weight;
+
+	return transform;
+}
@@ -0,0 +1,12 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+typedef struct {
+	float x, y;
+	float rotation;
+} Transform;
+
+// rotation takes the shorter way around
+Transform transformInterpolate(const Transform &from, const Transform &to, float weight);
+
+#endif // !TRANSFORM_H
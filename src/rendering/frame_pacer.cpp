@@ -0,0 +1,67 @@
+#include <cmath>
+
+#include "frame_pacer.h"
+
+// how fast the work estimate decays after a heavy frame, it rises at once
+const double WORK_TIME_DECAY = 0.05;
+
+// slack for scheduling jitter, a missed refresh costs a whole interval
+const double SAFETY_MARGIN = 0.002;
+
+bool FramePacer::isEnabled() const {
+	return m_enabled;
+}
+
+double FramePacer::refreshInterval() const {
+	return m_refreshInterval;
+}
+
+void FramePacer::enabledSet(bool enabled) {
+	m_enabled = enabled;
+	m_workTime = 0.0;
+	m_presented = false;
+}
+
+void FramePacer::refreshRateSet(double refreshRate) {
+	if (refreshRate <= 0.0)
+		return;
+
+	m_refreshInterval = 1.0 / refreshRate;
+}
+
+void FramePacer::frameStarted(double time) {
+	m_frameStartTime = time;
+}
+
+void FramePacer::frameFinished(double time) {
+	double workTime = time - m_frameStartTime;
+	if (workTime <= 0.0)
+		return;
+
+	// starting late is worse than starting early, follow spikes immediately
+	if (workTime > m_workTime) {
+		m_workTime = workTime;
+	} else {
+		m_workTime += (workTime - m_workTime) * WORK_TIME_DECAY;
+	}
+}
+
+void FramePacer::framePresented(double time) {
+	m_presentTime = time;
+	m_presented = true;
+}
+
+double FramePacer::nextFrameStart(double now) const {
+	if (!m_enabled || !m_presented)
+		return now;
+
+	double lead = m_workTime + SAFETY_MARGIN;
+
+	// the first refresh after the last present the next frame can still make
+	double refreshes = std::ceil((now + lead - m_presentTime) / m_refreshInterval);
+	if (refreshes < 1.0)
+		refreshes = 1.0;
+
+	double start = m_presentTime + refreshes * m_refreshInterval - lead;
+	return start > now ? start : now;
+}
@@ -0,0 +1,35 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+// Delays the start of a frame so it finishes just before the display refreshes,
+// instead of finishing early and waiting in the swapchain queue. Times are in
+// seconds on one monotonic clock.
+class FramePacer {
+private:
+	bool m_enabled = false;
+
+	double m_refreshInterval = 1.0 / 60.0;
+
+	double m_frameStartTime = 0.0;
+	double m_workTime = 0.0;
+
+	double m_presentTime = 0.0;
+	bool m_presented = false;
+
+public:
+	bool isEnabled() const;
+	double refreshInterval() const;
+
+	void enabledSet(bool enabled);
+	void refreshRateSet(double refreshRate);
+
+	void frameStarted(double time);
+	// the GPU is done with the frame
+	void frameFinished(double time);
+	// the frame reached the display, or the best guess there is when that cannot be measured
+	void framePresented(double time);
+
+	double nextFrameStart(double now) const;
+};
+
+#endif // !FRAME_PACER_H
@@ -0,0 +1,140 @@
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "io/image.h"
+
+#include "page_cache.h"
+
+const uint32_t NO_SLOT = UINT32_MAX;
+const uint32_t NO_PAGE = UINT32_MAX;
+
+const size_t TEXEL_SIZE = 4;
+
+static int32_t clampInt(int32_t value, int32_t minimum, int32_t maximum) {
+	return value < minimum ? minimum : (value > maximum ? maximum : value);
+}
+
+void PageCache::create(uint32_t width, uint32_t height) {
+	m_width = width;
+	m_height = height;
+	m_pagesX = (width + PAGE_CONTENT - 1) / PAGE_CONTENT;
+	m_pagesY = (height + PAGE_CONTENT - 1) / PAGE_CONTENT;
+	m_slotsX = PAGE_CACHE_SIZE / PAGE_SIZE;
+
+	m_pageSlots.assign((size_t)m_pagesX * m_pagesY, NO_SLOT);
+	m_slotPages.assign((size_t)m_slotsX * m_slotsX, NO_PAGE);
+	m_slotFrames.assign(m_slotPages.size(), 0);
+}
+
+void PageCache::clear() {
+	m_pageSlots.assign(m_pageSlots.size(), NO_SLOT);
+	m_slotPages.assign(m_slotPages.size(), NO_PAGE);
+	m_slotFrames.assign(m_slotFrames.size(), 0);
+}
+
+uint32_t PageCache::pagesX() const {
+	return m_pagesX;
+}
+
+uint32_t PageCache::pagesY() const {
+	return m_pagesY;
+}
+
+uint32_t PageCache::pageSlot(uint32_t page) const {
+	return m_pageSlots[page];
+}
+
+uint32_t PageCache::slotX(uint32_t slot) const {
+	return slot % m_slotsX;
+}
+
+uint32_t PageCache::slotY(uint32_t slot) const {
+	return slot / m_slotsX;
+}
+
+void PageCache::request(
+		float minX, float minY, float maxX, float maxY, uint64_t frame, std::vector<uint32_t> *missing) {
+	if (maxX < 0.0f || maxY < 0.0f || minX >= (float)m_width || minY >= (float)m_height)
+		return;
+
+	int32_t firstX = clampInt((int32_t)std::floor(minX / PAGE_CONTENT), 0, m_pagesX - 1);
+	int32_t firstY = clampInt((int32_t)std::floor(minY / PAGE_CONTENT), 0, m_pagesY - 1);
+	int32_t lastX = clampInt((int32_t)std::floor(maxX / PAGE_CONTENT), 0, m_pagesX - 1);
+	int32_t lastY = clampInt((int32_t)std::floor(maxY / PAGE_CONTENT), 0, m_pagesY - 1);
+
+	for (int32_t y = firstY; y <= lastY; y++) {
+		for (int32_t x = firstX; x <= lastX; x++) {
+			uint32_t page = y * m_pagesX + x;
+			uint32_t slot = m_pageSlots[page];
+
+			if (slot == NO_SLOT) {
+				missing->push_back(page);
+				continue;
+			}
+
+			m_slotFrames[slot] = frame;
+		}
+	}
+}
+
+bool PageCache::slotAssign(uint32_t page, uint64_t frame, uint32_t *slot, uint32_t *evicted) {
+	uint32_t oldest = NO_SLOT;
+
+	for (uint32_t i = 0; i < m_slotPages.size(); i++) {
+		if (m_slotPages[i] == NO_PAGE) {
+			oldest = i;
+			break;
+		}
+
+		if (m_slotFrames[i] == frame)
+			continue;
+
+		if (oldest == NO_SLOT || m_slotFrames[i] < m_slotFrames[oldest])
+			oldest = i;
+	}
+
+	if (oldest == NO_SLOT)
+		return false;
+
+	*evicted = m_slotPages[oldest];
+	if (*evicted != NO_PAGE)
+		m_pageSlots[*evicted] = NO_SLOT;
+
+	m_pageSlots[page] = oldest;
+	m_slotPages[oldest] = page;
+	m_slotFrames[oldest] = frame;
+
+	*slot = oldest;
+	return true;
+}
+
+void PageCache::pageCopy(const Image &image, uint32_t page, uint8_t *destination) const {
+	const uint8_t *pixels = image.data();
+	size_t rowSize = (size_t)m_width * TEXEL_SIZE;
+
+	// the first texel of the page, border included, may lie one before the image
+	int32_t originX = (int32_t)((page % m_pagesX) * PAGE_CONTENT) - (int32_t)PAGE_BORDER;
+	int32_t originY = (int32_t)((page / m_pagesX) * PAGE_CONTENT) - (int32_t)PAGE_BORDER;
+
+	// the columns inside the image are copied as one run, the ones outside repeat the edge texel
+	int32_t firstX = clampInt(originX, 0, m_width - 1);
+	int32_t lastX = clampInt(originX + (int32_t)PAGE_SIZE - 1, 0, m_width - 1);
+	uint32_t before = (uint32_t)(firstX - originX);
+	uint32_t inside = (uint32_t)(lastX - firstX + 1);
+
+	for (uint32_t row = 0; row < PAGE_SIZE; row++) {
+		int32_t y = clampInt(originY + (int32_t)row, 0, m_height - 1);
+		const uint8_t *source = pixels + y * rowSize;
+		uint8_t *target = destination + row * PAGE_SIZE * TEXEL_SIZE;
+
+		for (uint32_t x = 0; x < before; x++)
+			memcpy(target + x * TEXEL_SIZE, source + firstX * TEXEL_SIZE, TEXEL_SIZE);
+
+		memcpy(target + before * TEXEL_SIZE, source + firstX * TEXEL_SIZE, inside * TEXEL_SIZE);
+
+		for (uint32_t x = before + inside; x < PAGE_SIZE; x++)
+			memcpy(target + x * TEXEL_SIZE, source + lastX * TEXEL_SIZE, TEXEL_SIZE);
+	}
+}
@@ -0,0 +1,61 @@
+#ifndef PAGE_CACHE_H
+#define PAGE_CACHE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "io/image.h"
+
+// pages are square and carry a border copied from their neighbours, so filtering across page edges
+// reads the same texels it would from the whole image; tiled_sprite.frag has to match
+const uint32_t PAGE_SIZE = 256;
+const uint32_t PAGE_BORDER = 1;
+const uint32_t PAGE_CONTENT = PAGE_SIZE - 2 * PAGE_BORDER;
+
+// edge of the square cache texture, 256 pages and 64 MiB of RGBA8 whatever the size of the image
+const uint32_t PAGE_CACHE_SIZE = 4096;
+
+// page table entry of a page without a slot, slots are stored as their column and row
+const uint8_t PAGE_MISSING = 255;
+
+// Which page of a tiled image sits in which slot of its cache texture. Only the
+// pages around the view are requested, a page is given the slot of the one that
+// has not been requested for the longest, so the cache never grows with the image.
+class PageCache {
+private:
+	uint32_t m_width = 0;
+	uint32_t m_height = 0;
+	uint32_t m_pagesX = 0;
+	uint32_t m_pagesY = 0;
+	uint32_t m_slotsX = 0;
+
+	// UINT32_MAX for pages without a slot and slots without a page
+	std::vector<uint32_t> m_pageSlots;
+	std::vector<uint32_t> m_slotPages;
+	// frame count when the page in the slot was last requested
+	std::vector<uint64_t> m_slotFrames;
+
+public:
+	void create(uint32_t width, uint32_t height);
+	// forgets every slot, for when the cache texture was released
+	void clear();
+
+	uint32_t pagesX() const;
+	uint32_t pagesY() const;
+	// UINT32_MAX when the page has no slot
+	uint32_t pageSlot(uint32_t page) const;
+	// column and row of the slot in the cache texture, in slots
+	uint32_t slotX(uint32_t slot) const;
+	uint32_t slotY(uint32_t slot) const;
+
+	// marks the cached pages overlapping the texel rectangle as used this frame and appends the others to missing
+	void request(float minX, float minY, float maxX, float maxY, uint64_t frame, std::vector<uint32_t> *missing);
+	// takes the slot requested longest ago, the page it held is returned in evicted or UINT32_MAX when it was
+	// free; fails when every slot was requested this frame
+	bool slotAssign(uint32_t page, uint64_t frame, uint32_t *slot, uint32_t *evicted);
+
+	// writes the page with its border as PAGE_SIZE rows of RGBA8 texels, texels beyond the image repeat its edge
+	void pageCopy(const Image &image, uint32_t page, uint8_t *destination) const;
+};
+
+#endif // !PAGE_CACHE_H
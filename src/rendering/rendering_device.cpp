@@ -1,7 +1,12 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <thread>
+#include <utility>
 
 #include <sys/types.h>
 #include <vma/vk_mem_alloc.h>
@@ -11,7 +16,11 @@
 #include "io/image_loader.h"
 #include "math/matrix.h"
 #include "rendering/shaders/glsl/checkerboard.gen.h"
+#include "rendering/shaders/glsl/fxaa.gen.h"
+#include "rendering/shaders/glsl/nearest.gen.h"
 #include "rendering/shaders/glsl/sprite.gen.h"
+#include "rendering/shaders/glsl/tiled_sprite.gen.h"
+#include "rendering/shaders/glsl/upscale.gen.h"
 
 #include "rendering_device.h"
 
@@ -20,8 +29,49 @@
 		printf("%s\n", msg);                                                                                           \
 	}
 
+// linear and with alpha, so sprites blend the same way they did into the swapchain
+const VkFormat SCENE_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+
+// a present that takes longer than this is not waited for, in nanoseconds
+const uint64_t PRESENT_WAIT_TIMEOUT = 100000000;
+
+// sleeping tends to overshoot, the last stretch before a deadline is spent yielding
+const double SLEEP_SLACK = 0.001;
+
+// upload memory is carved out of chunks this big, larger images get a chunk of their own
+const VkDeviceSize STAGING_CHUNK_SIZE = 16 * 1024 * 1024;
+// covers the texel size of every format and the optimal copy offset alignment of common GPUs
+const VkDeviceSize STAGING_ALIGNMENT = 16;
+
+// one texel per page, the column and row of its slot in the cache
+const VkFormat PAGE_TABLE_FORMAT = VK_FORMAT_R8G8_UINT;
+
+const VkDeviceSize PAGE_BYTES = PAGE_SIZE * PAGE_SIZE * 4;
+// page table entries are copied one texel each, buffer offsets of copies are multiples of 4
+const VkDeviceSize PAGE_TABLE_ENTRY_STRIDE = 4;
+// every page copied may evict another, both have their entry rewritten
+const VkDeviceSize PAGE_STAGING_SIZE = MAX_PAGE_UPLOADS * (PAGE_BYTES + 2 * PAGE_TABLE_ENTRY_STRIDE);
+
+// textures are evicted beyond this fraction of the device heap budget, past the budget the system pages memory out
+const float TEXTURE_BUDGET_SHARE = 0.9f;
+
+static double currentTime() {
+	std::chrono::duration<double> time = std::chrono::steady_clock::now().time_since_epoch();
+	return time.count();
+}
+
+static void sleepUntil(double time) {
+	double remaining = time - currentTime();
+	if (remaining > SLEEP_SLACK)
+		std::this_thread::sleep_for(std::chrono::duration<double>(remaining - SLEEP_SLACK));
+
+	while (currentTime() < time)
+		std::this_thread::yield();
+}
+
 static VkPipeline pipelineCreate(VkDevice device, VkShaderModule vertexModule, VkShaderModule fragmentModule,
-		VkPipelineLayout pipelineLayout, VkRenderPass renderPass, uint32_t subpass) {
+		VkPipelineLayout pipelineLayout, VkRenderPass renderPass, uint32_t subpass, VkSampleCountFlagBits samples,
+		bool blendEnable) {
 	VkPipelineShaderStageCreateInfo vertexStageInfo = {
 		.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
 		.stage = VK_SHADER_STAGE_VERTEX_BIT,
@@ -68,7 +118,7 @@ static VkPipeline pipelineCreate(VkDevice device, VkShaderModule vertexModule, V
 
 	VkPipelineMultisampleStateCreateInfo multisampleStateInfo = {
 		.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
-		.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+		.rasterizationSamples = samples,
 		.sampleShadingEnable = VK_FALSE,
 	};
 
@@ -81,13 +131,14 @@ static VkPipeline pipelineCreate(VkDevice device, VkShaderModule vertexModule, V
 		.stencilTestEnable = VK_FALSE,
 	};
 
+	// colors arrive premultiplied by alpha, so both color and alpha are composited with the same over operator
 	VkPipelineColorBlendAttachmentState colorBlendAttachment = {
-		.blendEnable = VK_TRUE,
-		.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA,
+		.blendEnable = blendEnable ? VK_TRUE : VK_FALSE,
+		.srcColorBlendFactor = VK_BLEND_FACTOR_ONE,
 		.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
 		.colorBlendOp = VK_BLEND_OP_ADD,
 		.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
-		.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
+		.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
 		.alphaBlendOp = VK_BLEND_OP_ADD,
 		.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT |
 						  VK_COLOR_COMPONENT_A_BIT,
@@ -138,40 +189,6 @@ static VkPipeline pipelineCreate(VkDevice device, VkShaderModule vertexModule, V
 	return pipeline;
 }
 
-VkCommandBuffer RD::_beginSingleTimeCommands() {
-	VkCommandBufferAllocateInfo allocInfo = {
-		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-		.commandPool = m_context.commandPool(),
-		.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-		.commandBufferCount = 1,
-	};
-
-	VkCommandBuffer commandBuffer;
-	vkAllocateCommandBuffers(m_context.device(), &allocInfo, &commandBuffer);
-
-	VkCommandBufferBeginInfo beginInfo = {
-		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-	};
-
-	vkBeginCommandBuffer(commandBuffer, &beginInfo);
-	return commandBuffer;
-}
-
-void RD::_endSingleTimeCommands(VkCommandBuffer commandBuffer) {
-	vkEndCommandBuffer(commandBuffer);
-
-	VkSubmitInfo submitInfo = {
-		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-		.commandBufferCount = 1,
-		.pCommandBuffers = &commandBuffer,
-	};
-
-	vkQueueSubmit(m_context.graphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(m_context.graphicsQueue());
-	vkFreeCommandBuffers(m_context.device(), m_context.commandPool(), 1, &commandBuffer);
-}
-
 AllocatedBuffer RD::_bufferCreate(size_t size, VkBufferUsageFlags usage, VmaAllocationInfo *allocInfo) {
 	VkBufferCreateInfo createInfo = {
 		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
@@ -189,42 +206,41 @@ AllocatedBuffer RD::_bufferCreate(size_t size, VkBufferUsageFlags usage, VmaAllo
 	return buffer;
 }
 
-void RD::_bufferCopy(VkBuffer srcBuffer, VkBuffer dstBuffer, size_t size) {
-	VkCommandBuffer commandBuffer = _beginSingleTimeCommands();
+void RD::_bufferUpdate(VkBuffer buffer, void *data, size_t size) {
+	StagingAllocation staging;
+	if (!_stagingAllocate(size, &staging)) {
+		printf("Staging memory exhausted, buffer update skipped!\n");
+		return;
+	}
+
+	memcpy(staging.data, data, size);
+	m_stagingPool.flush(staging, size);
 
-	VkBufferCopy bufferCopy = {
-		.srcOffset = 0,
-		.dstOffset = 0,
+	BufferUpload upload = {
+		.srcBuffer = staging.buffer,
+		.srcOffset = staging.offset,
+		.dstBuffer = buffer,
 		.size = size,
 	};
 
-	vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &bufferCopy);
-
-	_endSingleTimeCommands(commandBuffer);
-}
-
-void RD::_bufferUpdate(VkBuffer buffer, void *data, size_t size) {
-	VmaAllocationInfo allocInfo;
-	AllocatedBuffer staging = _bufferCreate(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, &allocInfo);
-
-	memcpy(allocInfo.pMappedData, data, size);
-	vmaFlushAllocation(m_allocator, staging.allocation, 0, VK_WHOLE_SIZE);
-	_bufferCopy(staging.handle, buffer, size);
+	// goes out with the next batch, the new contents are visible once _uploadPoll sees it done
+	m_bufferUploads.push_back(upload);
 }
 
 void RD::_bufferDestroy(AllocatedBuffer buffer) {
 	vmaDestroyBuffer(m_allocator, buffer.handle, buffer.allocation);
 }
 
-AllocatedImage RD::_imageCreate(uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage) {
+AllocatedImage RD::_imageCreate(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format,
+		VkImageUsageFlags usage, VkSampleCountFlagBits samples) {
 	VkImageCreateInfo createInfo = {
 		.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
 		.imageType = VK_IMAGE_TYPE_2D,
 		.format = format,
 		.extent = { width, height, 1 },
-		.mipLevels = 1,
+		.mipLevels = mipLevels,
 		.arrayLayers = 1,
-		.samples = VK_SAMPLE_COUNT_1_BIT,
+		.samples = samples,
 		.tiling = VK_IMAGE_TILING_OPTIMAL,
 		.usage = usage,
 		.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
@@ -238,228 +254,1684 @@ AllocatedImage RD::_imageCreate(uint32_t width, uint32_t height, VkFormat format
 	};
 
 	AllocatedImage image;
+
+	// transient attachments can stay in tile memory on GPUs that support lazy allocation
+	if (usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) {
+		VmaAllocationCreateInfo lazyAllocInfo = allocInfo;
+		lazyAllocInfo.usage = VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED;
+
+		if (vmaCreateImage(m_allocator, &createInfo, &lazyAllocInfo, &image.handle, &image.allocation, nullptr) ==
+				VK_SUCCESS)
+			return image;
+	}
+
 	vmaCreateImage(m_allocator, &createInfo, &allocInfo, &image.handle, &image.allocation, nullptr);
 
 	return image;
 }
 
-void RD::_imageUpdate(VkImage image, uint32_t width, uint32_t height, VkFormat format, void *data, size_t size) {
-	VmaAllocationInfo stagingAllocInfo;
-	VkBufferUsageFlags usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+void RD::_imageDestroy(AllocatedImage image) {
+	vmaDestroyImage(m_allocator, image.handle, image.allocation);
+}
+
+VkImageView RD::_imageViewCreate(VkImage image, uint32_t mipLevels, VkFormat format) {
+	VkImageSubresourceRange subresourceRange = {
+		.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+		.baseMipLevel = 0,
+		.levelCount = mipLevels,
+		.baseArrayLayer = 0,
+		.layerCount = 1,
+	};
+
+	VkImageViewCreateInfo viewInfo = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+		.image = image,
+		.viewType = VK_IMAGE_VIEW_TYPE_2D,
+		.format = format,
+		.subresourceRange = subresourceRange,
+	};
+
+	VkImageView view;
+	CHECK_VK_RESULT(vkCreateImageView(m_context.device(), &viewInfo, nullptr, &view) == VK_SUCCESS,
+			"Image view creation failed!");
+
+	return view;
+}
+
+void RD::_imageViewDestroy(VkImageView imageView) {
+	vkDestroyImageView(m_context.device(), imageView, nullptr);
+}
 
-	AllocatedBuffer stagingBuffer = _bufferCreate(size, usage, &stagingAllocInfo);
-	memcpy(stagingAllocInfo.pMappedData, data, size);
-	vmaFlushAllocation(m_allocator, stagingBuffer.allocation, 0, VK_WHOLE_SIZE);
+void RD::_mipmapsRecord(VkCommandBuffer commandBuffer, const ImageUpload &upload) {
+	VkImageSubresourceRange subresourceRange = {
+		.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+		.baseMipLevel = 0,
+		.levelCount = 1,
+		.baseArrayLayer = 0,
+		.layerCount = 1,
+	};
 
-	VkCommandBuffer commandBuffer = _beginSingleTimeCommands();
+	VkImageMemoryBarrier imageBarrier = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = upload.dstImage,
+		.subresourceRange = subresourceRange,
+	};
 
-	{
-		VkImageSubresourceRange subresourceRange = {
-			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-			.baseMipLevel = 0,
-			.levelCount = 1,
-			.baseArrayLayer = 0,
-			.layerCount = 1,
-		};
+	// pre-encoded chains arrive whole, compressed formats could not be blitted anyway
+	if (upload.copiedLevels == upload.mipLevels) {
+		imageBarrier.subresourceRange.levelCount = upload.mipLevels;
+		imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		imageBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
-		VkImageMemoryBarrier imageBarrier = {
-			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-			.srcAccessMask = VK_ACCESS_NONE,
-			.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
-			.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-			.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-			.image = image,
-			.subresourceRange = subresourceRange,
-		};
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+				0, nullptr, 0, nullptr, 1, &imageBarrier);
+		return;
+	}
 
-		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0,
+	int32_t width = upload.width;
+	int32_t height = upload.height;
+
+	// each level is blitted down from the one above, which is done with afterwards
+	for (uint32_t level = 1; level < upload.mipLevels; level++) {
+		imageBarrier.subresourceRange.baseMipLevel = level - 1;
+		imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0,
 				nullptr, 0, nullptr, 1, &imageBarrier);
+
+		int32_t mipWidth = width > 1 ? width / 2 : 1;
+		int32_t mipHeight = height > 1 ? height / 2 : 1;
+
+		VkImageBlit blit = {
+			.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1 },
+			.srcOffsets = { { 0, 0, 0 }, { width, height, 1 } },
+			.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 },
+			.dstOffsets = { { 0, 0, 0 }, { mipWidth, mipHeight, 1 } },
+		};
+
+		// linear blits are guaranteed for RGBA8 with optimal tiling
+		vkCmdBlitImage(commandBuffer, upload.dstImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, upload.dstImage,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+		imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		imageBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+				0, nullptr, 0, nullptr, 1, &imageBarrier);
+
+		width = mipWidth;
+		height = mipHeight;
 	}
 
-	{
+	imageBarrier.subresourceRange.baseMipLevel = upload.mipLevels - 1;
+	imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	imageBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0,
+			nullptr, 0, nullptr, 1, &imageBarrier);
+}
+
+void RD::_imageCopyRecord(VkCommandBuffer commandBuffer, const ImageUpload &upload) {
+	VkDeviceSize levelOffset = upload.srcOffset;
+
+	for (uint32_t level = 0; level < upload.copiedLevels; level++) {
+		uint32_t levelWidth = upload.width >> level > 0 ? upload.width >> level : 1;
+		uint32_t levelHeight = upload.height >> level > 0 ? upload.height >> level : 1;
+
 		VkImageSubresourceLayers imageSubresource = {
 			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-			.mipLevel = 0,
+			.mipLevel = level,
 			.baseArrayLayer = 0,
 			.layerCount = 1,
 		};
 
 		VkExtent3D imageExtent = {
-			.width = width,
-			.height = height,
+			.width = levelWidth,
+			.height = levelHeight,
 			.depth = 1,
 		};
 
+		// whole levels only, a dedicated transfer queue may not copy at a finer granularity
 		VkBufferImageCopy region = {
+			.bufferOffset = levelOffset,
 			.imageSubresource = imageSubresource,
 			.imageExtent = imageExtent,
 		};
 
 		vkCmdCopyBufferToImage(
-				commandBuffer, stagingBuffer.handle, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+				commandBuffer, upload.srcBuffer, upload.dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+		levelOffset += imageFormatSize(upload.format, levelWidth, levelHeight);
 	}
+}
 
-	{
-		VkImageSubresourceRange subresourceRange = {
-			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-			.baseMipLevel = 0,
-			.levelCount = 1,
-			.baseArrayLayer = 0,
-			.layerCount = 1,
-		};
+// sRGB formats are decoded by the sampler before filtering, so shaders only ever see linear values
+static VkFormat textureFormat(ImageFormat format, ImageColorSpace colorSpace) {
+	bool srgb = colorSpace == IMAGE_COLOR_SPACE_SRGB;
+
+	switch (format) {
+		case IMAGE_FORMAT_BC1:
+			return srgb ? VK_FORMAT_BC1_RGBA_SRGB_BLOCK : VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+		case IMAGE_FORMAT_BC3:
+			return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+		case IMAGE_FORMAT_BC7:
+			return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+		default:
+			return srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+	}
+}
 
-		VkImageMemoryBarrier imageBarrier = {
-			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-			.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
-			.dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
-			.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-			.image = image,
-			.subresourceRange = subresourceRange,
-		};
+static uint32_t mipLevelCount(uint32_t width, uint32_t height) {
+	uint32_t size = width > height ? width : height;
+	uint32_t levels = 1;
 
-		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0,
-				nullptr, 0, nullptr, 1, &imageBarrier);
+	while (size > 1) {
+		size >>= 1;
+		levels++;
 	}
 
-	_endSingleTimeCommands(commandBuffer);
-	_bufferDestroy(stagingBuffer);
+	return levels;
 }
 
-void RD::_imageDestroy(AllocatedImage image) {
-	vmaDestroyImage(m_allocator, image.handle, image.allocation);
+Texture RD::_textureCreate(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, TextureFilter filter) {
+	// the chain is blitted from the first level, so the image is a transfer source as well
+	VkImageUsageFlags usage =
+			VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+
+	Texture texture;
+	texture.mipLevels = mipLevels;
+	texture.image = _imageCreate(width, height, texture.mipLevels, format, usage, VK_SAMPLE_COUNT_1_BIT);
+	texture.view = _imageViewCreate(texture.image.handle, texture.mipLevels, format);
+	texture.width = width;
+	texture.height = height;
+	texture.pageTable = {};
+	texture.pageTableView = VK_NULL_HANDLE;
+
+	VmaAllocationInfo allocationInfo;
+	vmaGetAllocationInfo(m_allocator, texture.image.allocation, &allocationInfo);
+	texture.memorySize = allocationInfo.size;
+
+	m_textureMemory += texture.memorySize;
+	m_textureCount += 1;
+
+	VkDescriptorSetAllocateInfo allocInfo = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+		.descriptorPool = m_textureDescriptorPool,
+		.descriptorSetCount = 1,
+		.pSetLayouts = &m_textureSetLayout,
+	};
+
+	CHECK_VK_RESULT(vkAllocateDescriptorSets(m_context.device(), &allocInfo, &texture.set) == VK_SUCCESS,
+			"Texture set allocation failed!");
+
+	VkDescriptorImageInfo samplerInfo = {
+		.sampler = filter == TEXTURE_FILTER_TRILINEAR ? m_trilinearSampler : m_sampler,
+	};
+
+	VkDescriptorImageInfo imageInfo = {
+		.imageView = texture.view,
+		.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+	};
+
+	VkWriteDescriptorSet samplerWriteInfo = {
+		.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		.dstSet = texture.set,
+		.dstBinding = 0,
+		.descriptorCount = 1,
+		.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER,
+		.pImageInfo = &samplerInfo,
+	};
+
+	VkWriteDescriptorSet imageWriteInfo = {
+		.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		.dstSet = texture.set,
+		.dstBinding = 1,
+		.descriptorCount = 1,
+		.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+		.pImageInfo = &imageInfo,
+	};
+
+	VkWriteDescriptorSet writeInfos[] = {
+		samplerWriteInfo,
+		imageWriteInfo,
+	};
+
+	vkUpdateDescriptorSets(m_context.device(), 2, writeInfos, 0, nullptr);
+	return texture;
 }
 
-VkImageView RD::_imageViewCreate(VkImage image, VkFormat format) {
-	VkImageSubresourceRange subresourceRange = {
-		.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-		.baseMipLevel = 0,
-		.levelCount = 1,
-		.baseArrayLayer = 0,
-		.layerCount = 1,
+Texture RD::_tiledTextureCreate(const Image &image, TextureFilter filter, const PageCache &pages) {
+	VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	VkFormat format = textureFormat(image.format(), image.colorSpace());
+
+	Texture texture;
+	texture.mipLevels = 1;
+	texture.image = _imageCreate(PAGE_CACHE_SIZE, PAGE_CACHE_SIZE, 1, format, usage, VK_SAMPLE_COUNT_1_BIT);
+	texture.view = _imageViewCreate(texture.image.handle, 1, format);
+	texture.pageTable =
+			_imageCreate(pages.pagesX(), pages.pagesY(), 1, PAGE_TABLE_FORMAT, usage, VK_SAMPLE_COUNT_1_BIT);
+	texture.pageTableView = _imageViewCreate(texture.pageTable.handle, 1, PAGE_TABLE_FORMAT);
+	// drawn at the size of the image, only the part around the view is in the cache
+	texture.width = image.width();
+	texture.height = image.height();
+
+	VmaAllocationInfo allocationInfo;
+	vmaGetAllocationInfo(m_allocator, texture.image.allocation, &allocationInfo);
+	texture.memorySize = allocationInfo.size;
+
+	vmaGetAllocationInfo(m_allocator, texture.pageTable.allocation, &allocationInfo);
+	texture.memorySize += allocationInfo.size;
+
+	m_textureMemory += texture.memorySize;
+	m_textureCount += 1;
+
+	VkDescriptorSetAllocateInfo allocInfo = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+		.descriptorPool = m_textureDescriptorPool,
+		.descriptorSetCount = 1,
+		.pSetLayouts = &m_tiledTextureSetLayout,
 	};
 
-	VkImageViewCreateInfo viewInfo = {
-		.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-		.image = image,
-		.viewType = VK_IMAGE_VIEW_TYPE_2D,
-		.format = format,
-		.subresourceRange = subresourceRange,
+	CHECK_VK_RESULT(vkAllocateDescriptorSets(m_context.device(), &allocInfo, &texture.set) == VK_SUCCESS,
+			"Texture set allocation failed!");
+
+	// the cache has no smaller levels, trilinear filtering falls back to linear
+	VkDescriptorImageInfo samplerInfo = {
+		.sampler = filter == TEXTURE_FILTER_NEAREST ? m_sampler : m_linearSampler,
 	};
 
-	VkImageView view;
-	CHECK_VK_RESULT(vkCreateImageView(m_context.device(), &viewInfo, nullptr, &view) == VK_SUCCESS,
-			"Image view creation failed!");
+	VkDescriptorImageInfo imageInfos[] = {
+		{
+				.imageView = texture.view,
+				.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		},
+		{
+				.imageView = texture.pageTableView,
+				.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		},
+	};
 
-	return view;
+	VkWriteDescriptorSet samplerWriteInfo = {
+		.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		.dstSet = texture.set,
+		.dstBinding = 0,
+		.descriptorCount = 1,
+		.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER,
+		.pImageInfo = &samplerInfo,
+	};
+
+	VkWriteDescriptorSet imageWriteInfo = {
+		.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		.dstSet = texture.set,
+		.dstBinding = 1,
+		.descriptorCount = 2,
+		.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+		.pImageInfo = imageInfos,
+	};
+
+	VkWriteDescriptorSet writeInfos[] = {
+		samplerWriteInfo,
+		imageWriteInfo,
+	};
+
+	vkUpdateDescriptorSets(m_context.device(), 2, writeInfos, 0, nullptr);
+
+	// shared by every tiled texture, made when the first one is
+	if (!m_pageStagingCreated) {
+		for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+			VmaAllocationInfo stagingInfo;
+			m_pageStagingBuffers[i] = _bufferCreate(PAGE_STAGING_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, &stagingInfo);
+			m_pageStagingData[i] = stagingInfo.pMappedData;
+		}
+
+		m_pageStagingCreated = true;
+	}
+
+	return texture;
 }
 
-void RD::_imageViewDestroy(VkImageView imageView) {
-	vkDestroyImageView(m_context.device(), imageView, nullptr);
+void RD::_textureDestroy(const Texture &texture) {
+	vkFreeDescriptorSets(m_context.device(), m_textureDescriptorPool, 1, &texture.set);
+	_imageViewDestroy(texture.view);
+	_imageDestroy(texture.image);
+
+	if (texture.pageTableView != VK_NULL_HANDLE) {
+		_imageViewDestroy(texture.pageTableView);
+		_imageDestroy(texture.pageTable);
+	}
+
+	m_textureMemory -= texture.memorySize;
+	m_textureCount -= 1;
 }
 
-VkInstance RD::instance() {
-	return m_context.instance();
+void RD::_textureRetire(const Texture &texture) {
+	RetiredTexture retired = {
+		.texture = texture,
+		.frame = m_frameCount,
+	};
+
+	m_retiredTextures.push_back(retired);
 }
 
-void RD::draw() {
-	CHECK_VK_RESULT(vkWaitForFences(m_context.device(), 1, &m_renderFences[m_frame], VK_TRUE, UINT64_MAX) == VK_SUCCESS,
-			"Fence timed out!");
+void RD::_retiredTexturesCollect() {
+	// any fence waited on covers every earlier submission, so all but the last frames in flight are done
+	size_t i = 0;
+	while (i < m_retiredTextures.size()) {
+		if (m_frameCount < m_retiredTextures[i].frame + m_framesInFlight) {
+			i++;
+			continue;
+		}
 
-	uint32_t imageIndex = 0;
-	VkResult result = vkAcquireNextImageKHR(m_context.device(), m_context.swapchain(), UINT64_MAX,
-			m_presentSemaphores[m_frame], VK_NULL_HANDLE, &imageIndex);
+		_textureDestroy(m_retiredTextures[i].texture);
 
-	if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-		m_context.windowResize(m_width, m_height);
-	} else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
-		printf("Swapchain image acquire failed!\n");
+		m_retiredTextures[i] = m_retiredTextures.back();
+		m_retiredTextures.pop_back();
 	}
+}
 
-	vkResetFences(m_context.device(), 1, &m_renderFences[m_frame]);
+bool RD::_stagingAllocate(VkDeviceSize size, StagingAllocation *allocation) {
+	if (m_stagingPool.allocate(size, STAGING_ALIGNMENT, allocation))
+		return true;
 
-	vkResetCommandBuffer(m_commandBuffers[m_frame], 0);
+	// the memory is held by copies not submitted yet, send them off early so the pool can wait on them
+	_uploadFlush();
+	return m_stagingPool.allocate(size, STAGING_ALIGNMENT, allocation);
+}
 
-	VkExtent2D extent = m_context.swapchainExtent();
-	Matrix projection = projectionMatrix(extent.width, extent.height);
-	Matrix view = viewMatrix(0.0, 0.0);
+bool RD::_textureUpload(const Image &image, TextureFilter filter, Texture *texture) {
+	bool compressed = imageFormatIsCompressed(image.format());
 
-	SceneUBO ubo;
-	memcpy(ubo.projectionMatrix, projection.data, sizeof(projection.data));
-	memcpy(ubo.viewMatrix, view.data, sizeof(view.data));
+	if (compressed && !m_context.isTextureCompressionBCSupported()) {
+		printf("Block compressed textures are not supported by the device!\n");
+		return false;
+	}
 
-	memcpy(m_uniformBufferAllocInfos[m_frame].pMappedData, &ubo, sizeof(ubo));
+	// a single uncompressed level gets the rest of its chain blitted on the GPU
+	uint32_t mipLevels = image.mipLevels();
+	if (mipLevels == 1 && !compressed)
+		mipLevels = mipLevelCount(image.width(), image.height());
 
-	VkCommandBufferBeginInfo beginInfo = {
-		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+	StagingAllocation staging;
+	if (!_stagingAllocate(image.size(), &staging)) {
+		printf("Staging memory exhausted, image upload skipped!\n");
+		return false;
+	}
+
+	memcpy(staging.data, image.data(), image.size());
+	m_stagingPool.flush(staging, image.size());
+
+	VkFormat format = textureFormat(image.format(), image.colorSpace());
+	*texture = _textureCreate(image.width(), image.height(), mipLevels, format, filter);
+
+	ImageUpload upload = {
+		.srcBuffer = staging.buffer,
+		.srcOffset = staging.offset,
+		.dstImage = texture->image.handle,
+		.format = image.format(),
+		.width = texture->width,
+		.height = texture->height,
+		.mipLevels = texture->mipLevels,
+		.copiedLevels = image.mipLevels(),
 	};
 
-	vkBeginCommandBuffer(m_commandBuffers[m_frame], &beginInfo);
+	m_imageUploads.push_back(upload);
+	return true;
+}
 
-	VkClearValue clearValue = {
-		.color = { { 0.0f, 0.0f, 0.0f, 1.0f } },
-	};
+void RD::_textureDiscard(const Texture &texture, uint64_t serial) {
+	if (serial > m_uploadSerial) {
+		// not submitted yet, the copy is dropped and the texture never reaches the GPU
+		for (size_t i = 0; i < m_imageUploads.size(); i++) {
+			if (m_imageUploads[i].dstImage != texture.image.handle)
+				continue;
 
-	VkViewport viewport = {
-		.width = (float)extent.width,
-		.height = (float)extent.height,
-		.minDepth = 0.0f,
-		.maxDepth = 1.0f,
-	};
+			m_imageUploads.erase(m_imageUploads.begin() + i);
+			break;
+		}
 
-	VkRect2D scissor = {
-		.extent = extent,
-	};
+		_textureDestroy(texture);
+		return;
+	}
 
-	VkRect2D renderArea = {
-		.extent = extent,
+	// the batch is still recording the copy into it
+	DiscardedTexture discarded = {
+		.texture = texture,
+		.serial = serial,
 	};
 
-	VkRenderPassBeginInfo renderPassInfo = {
-		.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-		.renderPass = m_context.renderPass(),
-		.framebuffer = m_context.framebuffer(imageIndex),
-		.renderArea = renderArea,
-		.clearValueCount = 1,
-		.pClearValues = &clearValue,
-	};
+	m_discardedTextures.push_back(discarded);
+}
+
+bool RD::_isTiled(const Image &image) const {
+	uint32_t maxDimension = m_context.properties().limits.maxImageDimension2D;
+	if (image.width() > maxDimension || image.height() > maxDimension)
+		return true;
+
+	// past the size of the cache the whole image would take more memory than its pages ever do
+	return !imageFormatIsCompressed(image.format()) && image.levelSize(0) > PAGE_CACHE_SIZE * PAGE_CACHE_SIZE * 4;
+}
+
+bool RD::_textureMakeResident(TextureEntry &entry) {
+	entry.tiled = _isTiled(entry.image);
+
+	if (entry.tiled) {
+		if (imageFormatIsCompressed(entry.image.format())) {
+			printf("Block compressed image exceeds the texture size limit!\n");
+			return false;
+		}
+
+		entry.pages.create(entry.image.width(), entry.image.height());
+		entry.texture = _tiledTextureCreate(entry.image, entry.filter, entry.pages);
+		entry.pagesWritten = false;
+		entry.resident = true;
+		// nothing goes through the transfer queue, the frames drawing it copy the pages they need
+		entry.serial = m_completedUploadSerial;
+		return true;
+	}
+
+	if (!_textureUpload(entry.image, entry.filter, &entry.texture))
+		return false;
+
+	entry.resident = true;
+	entry.serial = m_uploadSerial + 1;
+	return true;
+}
+
+void RD::_textureRelease(TextureEntry &entry) {
+	if (!entry.resident)
+		return;
+
+	// either frames may still sample it or its copy has not been acquired yet
+	if (entry.serial > m_completedUploadSerial) {
+		_textureDiscard(entry.texture, entry.serial);
+	} else {
+		_textureRetire(entry.texture);
+	}
+
+	// a reload still on its way goes the same way
+	if (entry.replacing) {
+		if (entry.replacementSerial > m_completedUploadSerial) {
+			_textureDiscard(entry.replacement, entry.replacementSerial);
+		} else {
+			_textureRetire(entry.replacement);
+		}
+	}
+
+	entry.resident = false;
+	entry.refreshing = false;
+	entry.replacing = false;
+
+	if (entry.tiled)
+		entry.pages.clear();
+}
+
+VkDeviceSize RD::_textureMemoryExcess() {
+	// released textures are destroyed once the frames sampling them finish, they are as good as gone
+	VkDeviceSize released = 0;
+
+	for (const RetiredTexture &retired : m_retiredTextures)
+		released += retired.texture.memorySize;
+
+	for (const DiscardedTexture &discarded : m_discardedTextures)
+		released += discarded.texture.memorySize;
+
+	VkDeviceSize excess = 0;
+	VkDeviceSize used = m_textureMemory - released;
+
+	if (m_textureMemoryCap > 0 && used > m_textureMemoryCap)
+		excess = used - m_textureMemoryCap;
+
+	const VkPhysicalDeviceMemoryProperties *memoryProperties;
+	vmaGetMemoryProperties(m_allocator, &memoryProperties);
+
+	// the whole heap counts, render targets and other processes leave less room for textures
+	VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+	vmaGetHeapBudgets(m_allocator, budgets);
+
+	for (uint32_t i = 0; i < memoryProperties->memoryHeapCount; i++) {
+		if (!(memoryProperties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT))
+			continue;
+
+		VkDeviceSize limit = (VkDeviceSize)(budgets[i].budget * TEXTURE_BUDGET_SHARE);
+		VkDeviceSize usage = budgets[i].usage > released ? budgets[i].usage - released : 0;
+
+		if (usage > limit && usage - limit > excess)
+			excess = usage - limit;
+	}
+
+	return excess;
+}
+
+static bool isUsedEarlier(const TextureEntry *a, const TextureEntry *b) {
+	return a->lastUsedFrame < b->lastUsedFrame;
+}
+
+void RD::_texturesEvict(bool needsDescriptor) {
+	VkDeviceSize excess = _textureMemoryExcess();
+	if (excess == 0 && !needsDescriptor)
+		return;
+
+	// the shown and the requested texture are about to be drawn, anything else can go
+	std::vector<TextureEntry *> candidates;
+
+	for (std::unordered_map<uint32_t, TextureEntry>::iterator it = m_textures.begin(); it != m_textures.end(); ++it) {
+		if (!it->second.resident || it->first == m_shownTexture || it->first == m_spriteTexture)
+			continue;
+
+		candidates.push_back(&it->second);
+	}
+
+	std::sort(candidates.begin(), candidates.end(), isUsedEarlier);
+
+	for (TextureEntry *entry : candidates) {
+		if (excess == 0 && !needsDescriptor)
+			break;
+
+		VkDeviceSize size = entry->texture.memorySize;
+		_textureRelease(*entry);
+
+		excess = excess > size ? excess - size : 0;
+		needsDescriptor = false;
+	}
+}
+
+void RD::_texturesUpdate() {
+	std::unordered_map<uint32_t, TextureEntry>::iterator sprite = m_textures.find(m_spriteTexture);
+
+	if (sprite != m_textures.end() && !sprite->second.resident) {
+		if (m_textureCount >= MAX_TEXTURES) {
+			// released textures give their descriptor sets back within a few frames, evict only without any
+			_texturesEvict(m_retiredTextures.empty() && m_discardedTextures.empty());
+		} else if (!_textureMakeResident(sprite->second)) {
+			// the old sprite stays, asking again every frame would fail the same way
+			m_spriteTexture = m_shownTexture;
+		}
+	}
+
+	// after the upload, so a texture over the budget on its own still gets drawn
+	_texturesEvict(false);
+}
+
+static VkBufferImageCopy pageTableCopy(const PageCache &pages, uint32_t page, VkDeviceSize offset) {
+	VkBufferImageCopy copy = {
+		.bufferOffset = offset,
+		.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 },
+		.imageOffset = { (int32_t)(page % pages.pagesX()), (int32_t)(page / pages.pagesX()), 0 },
+		.imageExtent = { 1, 1, 1 },
+	};
+
+	return copy;
+}
+
+void RD::_pagesStream(VkCommandBuffer commandBuffer, TextureEntry &entry, VkExtent2D viewExtent) {
+	PageCache &pages = entry.pages;
+	float width = (float)entry.texture.width;
+	float height = (float)entry.texture.height;
+
+	// the corners of the view in texels of the image, the sprite is drawn at one texel per pixel
+	float sin = std::sin(m_spriteRotation);
+	float cos = std::cos(m_spriteRotation);
+	float halfWidth = viewExtent.width * 0.5f;
+	float halfHeight = viewExtent.height * 0.5f;
+
+	float minX = width, minY = height, maxX = 0.0f, maxY = 0.0f;
+
+	for (uint32_t i = 0; i < 4; i++) {
+		float dx = m_cameraX - m_spriteX + ((i & 1) ? halfWidth : -halfWidth);
+		float dy = m_cameraY - m_spriteY + ((i & 2) ? halfHeight : -halfHeight);
+
+		// world y points up, texel rows go down
+		float x = cos * dx + sin * dy + width * 0.5f;
+		float y = sin * dx - cos * dy + height * 0.5f;
+
+		minX = std::min(minX, x);
+		minY = std::min(minY, y);
+		maxX = std::max(maxX, x);
+		maxY = std::max(maxY, y);
+	}
+
+	// a ring of pages around the view is streamed ahead of panning
+	m_missingPages.clear();
+	pages.request(minX - PAGE_CONTENT, minY - PAGE_CONTENT, maxX + PAGE_CONTENT, maxY + PAGE_CONTENT, m_frameCount,
+			&m_missingPages);
+
+	// the middle of the view first, the ring last
+	float centerX = (minX + maxX) * 0.5f;
+	float centerY = (minY + maxY) * 0.5f;
+	uint32_t pagesX = pages.pagesX();
+
+	std::sort(m_missingPages.begin(), m_missingPages.end(), [=](uint32_t a, uint32_t b) {
+		float ax = ((a % pagesX) + 0.5f) * PAGE_CONTENT - centerX;
+		float ay = ((a / pagesX) + 0.5f) * PAGE_CONTENT - centerY;
+		float bx = ((b % pagesX) + 0.5f) * PAGE_CONTENT - centerX;
+		float by = ((b / pagesX) + 0.5f) * PAGE_CONTENT - centerY;
+		return ax * ax + ay * ay < bx * bx + by * by;
+	});
+
+	if (m_missingPages.empty() && entry.pagesWritten)
+		return;
+
+	uint8_t *staging = (uint8_t *)m_pageStagingData[m_frame];
+	VkDeviceSize tableOffset = MAX_PAGE_UPLOADS * PAGE_BYTES;
+
+	VkBufferImageCopy pageCopies[MAX_PAGE_UPLOADS];
+	VkBufferImageCopy tableCopies[2 * MAX_PAGE_UPLOADS];
+	uint32_t pageCopyCount = 0;
+	uint32_t tableCopyCount = 0;
+
+	for (uint32_t page : m_missingPages) {
+		if (pageCopyCount == MAX_PAGE_UPLOADS) {
+			m_pagesPending = true;
+			break;
+		}
+
+		// every slot holds a page around the view, the rest cannot be shown at this size
+		uint32_t slot, evicted;
+		if (!pages.slotAssign(page, m_frameCount, &slot, &evicted))
+			break;
+
+		VkDeviceSize offset = pageCopyCount * PAGE_BYTES;
+		pages.pageCopy(entry.image, page, staging + offset);
+
+		pageCopies[pageCopyCount] = {
+			.bufferOffset = offset,
+			.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 },
+			.imageOffset = { (int32_t)(pages.slotX(slot) * PAGE_SIZE), (int32_t)(pages.slotY(slot) * PAGE_SIZE), 0 },
+			.imageExtent = { PAGE_SIZE, PAGE_SIZE, 1 },
+		};
+
+		pageCopyCount += 1;
+
+		// evicted pages were not requested this frame, so no two copies write the same entry
+		if (evicted != UINT32_MAX) {
+			offset = tableOffset + tableCopyCount * PAGE_TABLE_ENTRY_STRIDE;
+			staging[offset] = PAGE_MISSING;
+			staging[offset + 1] = PAGE_MISSING;
+
+			tableCopies[tableCopyCount] = pageTableCopy(pages, evicted, offset);
+			tableCopyCount += 1;
+		}
+
+		offset = tableOffset + tableCopyCount * PAGE_TABLE_ENTRY_STRIDE;
+		staging[offset] = (uint8_t)pages.slotX(slot);
+		staging[offset + 1] = (uint8_t)pages.slotY(slot);
+
+		tableCopies[tableCopyCount] = pageTableCopy(pages, page, offset);
+		tableCopyCount += 1;
+	}
+
+	vmaFlushAllocation(m_allocator, m_pageStagingBuffers[m_frame].allocation, 0, VK_WHOLE_SIZE);
+
+	VkImageSubresourceRange range = {
+		.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+		.baseMipLevel = 0,
+		.levelCount = 1,
+		.baseArrayLayer = 0,
+		.layerCount = 1,
+	};
+
+	// earlier frames may still be sampling, the copies wait for their fragment shaders
+	VkImageMemoryBarrier barriers[2];
+
+	for (uint32_t i = 0; i < 2; i++) {
+		barriers[i] = {
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+			.srcAccessMask = 0,
+			.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+			.oldLayout = entry.pagesWritten ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED,
+			.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = i == 0 ? entry.texture.image.handle : entry.texture.pageTable.handle,
+			.subresourceRange = range,
+		};
+	}
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0,
+			nullptr, 0, nullptr, 2, barriers);
+
+	VkBuffer stagingBuffer = m_pageStagingBuffers[m_frame].handle;
+
+	if (!entry.pagesWritten) {
+		// every page starts out missing
+		VkClearColorValue clearColor = {};
+		clearColor.uint32[0] = PAGE_MISSING;
+		clearColor.uint32[1] = PAGE_MISSING;
+
+		vkCmdClearColorImage(commandBuffer, entry.texture.pageTable.handle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				&clearColor, 1, &range);
+
+		VkImageMemoryBarrier clearBarrier = barriers[1];
+		clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		clearBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0,
+				nullptr, 0, nullptr, 1, &clearBarrier);
+	}
+
+	if (pageCopyCount > 0) {
+		vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, entry.texture.image.handle,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, pageCopyCount, pageCopies);
+		vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, entry.texture.pageTable.handle,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, tableCopyCount, tableCopies);
+	}
+
+	for (uint32_t i = 0; i < 2; i++) {
+		barriers[i].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barriers[i].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barriers[i].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barriers[i].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	}
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0,
+			nullptr, 0, nullptr, 2, barriers);
+
+	entry.pagesWritten = true;
+}
+
+bool RD::_textureRefreshRecord(VkCommandBuffer commandBuffer, TextureEntry &entry) {
+	const Image &image = entry.image;
+
+	// tried again by the next frame
+	StagingAllocation staging;
+	if (!_stagingAllocate(image.size(), &staging))
+		return false;
+
+	memcpy(staging.data, image.data(), image.size());
+	m_stagingPool.flush(staging, image.size());
+
+	ImageUpload upload = {
+		.srcBuffer = staging.buffer,
+		.srcOffset = staging.offset,
+		.dstImage = entry.texture.image.handle,
+		.format = image.format(),
+		.width = entry.texture.width,
+		.height = entry.texture.height,
+		.mipLevels = entry.texture.mipLevels,
+		.copiedLevels = image.mipLevels(),
+	};
+
+	VkImageSubresourceRange subresourceRange = {
+		.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+		.baseMipLevel = 0,
+		.levelCount = upload.mipLevels,
+		.baseArrayLayer = 0,
+		.layerCount = 1,
+	};
+
+	// every level is written again, the old pixels need not survive the transition
+	VkImageMemoryBarrier imageBarrier = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_NONE,
+		.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+		.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = upload.dstImage,
+		.subresourceRange = subresourceRange,
+	};
+
+	// earlier frames may still sample the old pixels, the copy waits for their fragment shaders
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0,
+			nullptr, 0, nullptr, 1, &imageBarrier);
+
+	_imageCopyRecord(commandBuffer, upload);
+	_mipmapsRecord(commandBuffer, upload);
+	return true;
+}
+
+bool RD::_reloadsUpdate(VkCommandBuffer commandBuffer) {
+	// refreshes are read by this frame, so their staging memory is retired with its fence once that is submitted;
+	// copies waiting for a batch would be retired along with them, the refreshes wait until those went out
+	bool refreshAllowed = m_bufferUploads.empty() && m_imageUploads.empty();
+	bool refreshed = false;
+
+	size_t i = 0;
+	while (i < m_reloadedTextures.size()) {
+		std::unordered_map<uint32_t, TextureEntry>::iterator reloaded = m_textures.find(m_reloadedTextures[i]);
+
+		if (reloaded != m_textures.end()) {
+			TextureEntry &entry = reloaded->second;
+
+			if (entry.replacing && entry.replacementSerial <= m_completedUploadSerial) {
+				// acquired by this frame, the frames before keep sampling the old texture
+				_textureRetire(entry.texture);
+
+				entry.texture = entry.replacement;
+				entry.serial = entry.replacementSerial;
+				entry.replacing = false;
+
+				if (entry.tiled) {
+					entry.tiled = false;
+					entry.pages.clear();
+				}
+			}
+
+			if (entry.refreshing && refreshAllowed && _textureRefreshRecord(commandBuffer, entry)) {
+				entry.refreshing = false;
+				refreshed = true;
+			}
+
+			if (entry.replacing || entry.refreshing) {
+				i++;
+				continue;
+			}
+		}
+
+		m_reloadedTextures.erase(m_reloadedTextures.begin() + i);
+	}
+
+	return refreshed;
+}
+
+void RD::_uploadRecord(UploadBatch &batch) {
+	VkCommandBuffer commandBuffer = batch.commandBuffer;
+
+	// on another family the copies only release ownership, the graphics queue acquires it in _uploadPoll
+	bool release = m_context.transferQueueFamily() != m_context.graphicsQueueFamily();
+	uint32_t srcQueueFamily = release ? m_context.transferQueueFamily() : VK_QUEUE_FAMILY_IGNORED;
+	uint32_t dstQueueFamily = release ? m_context.graphicsQueueFamily() : VK_QUEUE_FAMILY_IGNORED;
+
+	VkImageSubresourceRange subresourceRange = {
+		.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+		.baseMipLevel = 0,
+		.levelCount = 1,
+		.baseArrayLayer = 0,
+		.layerCount = 1,
+	};
+
+	std::vector<VkImageMemoryBarrier> imageBarriers;
+	std::vector<VkBufferMemoryBarrier> bufferBarriers;
+
+	for (const ImageUpload &upload : m_imageUploads) {
+		subresourceRange.levelCount = upload.mipLevels;
+
+		VkImageMemoryBarrier imageBarrier = {
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_NONE,
+			.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+			.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+			.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = upload.dstImage,
+			.subresourceRange = subresourceRange,
+		};
+
+		imageBarriers.push_back(imageBarrier);
+	}
+
+	if (!imageBarriers.empty()) {
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0,
+				nullptr, 0, nullptr, imageBarriers.size(), imageBarriers.data());
+	}
+
+	for (const BufferUpload &upload : m_bufferUploads) {
+		VkBufferCopy bufferCopy = {
+			.srcOffset = upload.srcOffset,
+			.dstOffset = 0,
+			.size = upload.size,
+		};
+
+		vkCmdCopyBuffer(commandBuffer, upload.srcBuffer, upload.dstBuffer, 1, &bufferCopy);
+
+		VkBufferMemoryBarrier bufferBarrier = {
+			.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+			.dstAccessMask = release ? VK_ACCESS_NONE : VK_ACCESS_MEMORY_READ_BIT,
+			.srcQueueFamilyIndex = srcQueueFamily,
+			.dstQueueFamilyIndex = dstQueueFamily,
+			.buffer = upload.dstBuffer,
+			.offset = 0,
+			.size = upload.size,
+		};
+
+		bufferBarriers.push_back(bufferBarrier);
+	}
+
+	imageBarriers.clear();
+
+	for (const ImageUpload &upload : m_imageUploads) {
+		_imageCopyRecord(commandBuffer, upload);
+
+		if (!release) {
+			_mipmapsRecord(commandBuffer, upload);
+			continue;
+		}
+
+		subresourceRange.levelCount = upload.mipLevels;
+
+		// stays a transfer destination, the graphics queue finishes the chain
+		VkImageMemoryBarrier imageBarrier = {
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_NONE,
+			.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			.srcQueueFamilyIndex = srcQueueFamily,
+			.dstQueueFamilyIndex = dstQueueFamily,
+			.image = upload.dstImage,
+			.subresourceRange = subresourceRange,
+		};
+
+		imageBarriers.push_back(imageBarrier);
+	}
+
+	VkPipelineStageFlags dstStage = release ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT;
+
+	if (!bufferBarriers.empty() || !imageBarriers.empty()) {
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0, 0, nullptr,
+				bufferBarriers.size(), bufferBarriers.data(), imageBarriers.size(), imageBarriers.data());
+	}
+
+	if (!release)
+		return;
+
+	// the acquire repeats the release, with the access on the graphics side
+	for (VkBufferMemoryBarrier &bufferBarrier : bufferBarriers) {
+		bufferBarrier.srcAccessMask = VK_ACCESS_NONE;
+		bufferBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+	}
+
+	for (VkImageMemoryBarrier &imageBarrier : imageBarriers) {
+		imageBarrier.srcAccessMask = VK_ACCESS_NONE;
+		imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+	}
+
+	batch.bufferBarriers = bufferBarriers;
+	batch.imageBarriers = imageBarriers;
+	batch.mipmapUploads = m_imageUploads;
+}
+
+void RD::_uploadFlush() {
+	if (m_bufferUploads.empty() && m_imageUploads.empty())
+		return;
+
+	// back-pressure, with the transfer queue this far behind the copies wait for a later frame
+	if (m_uploadBatchCount == MAX_UPLOAD_BATCHES)
+		return;
+
+	UploadBatch &batch = m_uploadBatches[(m_uploadBatchFirst + m_uploadBatchCount) % MAX_UPLOAD_BATCHES];
+
+	VkCommandBufferAllocateInfo allocInfo = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+		.commandPool = m_context.transferCommandPool(),
+		.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+		.commandBufferCount = 1,
+	};
+
+	vkAllocateCommandBuffers(m_context.device(), &allocInfo, &batch.commandBuffer);
+
+	VkCommandBufferBeginInfo beginInfo = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+	};
+
+	batch.bufferBarriers.clear();
+	batch.imageBarriers.clear();
+	batch.mipmapUploads.clear();
+
+	vkBeginCommandBuffer(batch.commandBuffer, &beginInfo);
+	_uploadRecord(batch);
+	vkEndCommandBuffer(batch.commandBuffer);
+
+	VkSubmitInfo submitInfo = {
+		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		.commandBufferCount = 1,
+		.pCommandBuffers = &batch.commandBuffer,
+	};
+
+	vkResetFences(m_context.device(), 1, &batch.fence);
+	vkQueueSubmit(m_context.transferQueue(), 1, &submitInfo, batch.fence);
+	m_stagingPool.retire(batch.fence);
+
+	m_uploadSerial += 1;
+	batch.serial = m_uploadSerial;
+	m_uploadBatchCount += 1;
+
+	m_bufferUploads.clear();
+	m_imageUploads.clear();
+}
+
+void RD::_uploadPoll(VkCommandBuffer commandBuffer) {
+	while (m_uploadBatchCount > 0) {
+		UploadBatch &batch = m_uploadBatches[m_uploadBatchFirst];
+
+		if (vkGetFenceStatus(m_context.device(), batch.fence) != VK_SUCCESS)
+			break;
+
+		if (!batch.bufferBarriers.empty() || !batch.imageBarriers.empty()) {
+			VkPipelineStageFlags dstStage = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT;
+
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStage, 0, 0, nullptr,
+					batch.bufferBarriers.size(), batch.bufferBarriers.data(), batch.imageBarriers.size(),
+					batch.imageBarriers.data());
+		}
+
+		for (const ImageUpload &upload : batch.mipmapUploads)
+			_mipmapsRecord(commandBuffer, upload);
+
+		vkFreeCommandBuffers(m_context.device(), m_context.transferCommandPool(), 1, &batch.commandBuffer);
+
+		m_completedUploadSerial = batch.serial;
+		m_uploadBatchFirst = (m_uploadBatchFirst + 1) % MAX_UPLOAD_BATCHES;
+		m_uploadBatchCount -= 1;
+	}
+
+	// acquired above like the rest, so the frame being recorded references them too
+	size_t i = 0;
+	while (i < m_discardedTextures.size()) {
+		if (m_discardedTextures[i].serial > m_completedUploadSerial) {
+			i++;
+			continue;
+		}
+
+		_textureRetire(m_discardedTextures[i].texture);
+
+		m_discardedTextures[i] = m_discardedTextures.back();
+		m_discardedTextures.pop_back();
+	}
+
+	std::unordered_map<uint32_t, TextureEntry>::iterator sprite = m_textures.find(m_spriteTexture);
+	if (sprite == m_textures.end() || !sprite->second.resident || sprite->second.serial > m_completedUploadSerial)
+		return;
+
+	// the shown texture stays resident while other textures are evicted, the sprite takes its place now
+	m_shownTexture = m_spriteTexture;
+}
+
+static VkPresentModeKHR vulkanPresentMode(PresentMode presentMode) {
+	switch (presentMode) {
+		case PRESENT_MODE_FIFO_RELAXED:
+			return VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+		case PRESENT_MODE_MAILBOX:
+			return VK_PRESENT_MODE_MAILBOX_KHR;
+		case PRESENT_MODE_IMMEDIATE:
+			return VK_PRESENT_MODE_IMMEDIATE_KHR;
+		default:
+			return VK_PRESENT_MODE_FIFO_KHR;
+	}
+}
+
+VkSampleCountFlagBits RD::_sampleCount(AntiAliasing antiAliasing) const {
+	VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+
+	switch (antiAliasing) {
+		case ANTI_ALIASING_MSAA_2X:
+			samples = VK_SAMPLE_COUNT_2_BIT;
+			break;
+		case ANTI_ALIASING_MSAA_4X:
+			samples = VK_SAMPLE_COUNT_4_BIT;
+			break;
+		case ANTI_ALIASING_MSAA_8X:
+			samples = VK_SAMPLE_COUNT_8_BIT;
+			break;
+		default:
+			break;
+	}
+
+	// fall back to the highest count the device can render
+	VkSampleCountFlags supported = m_context.properties().limits.framebufferColorSampleCounts;
+	while (samples > VK_SAMPLE_COUNT_1_BIT && !(supported & samples)) {
+		samples = (VkSampleCountFlagBits)(samples >> 1);
+	}
+
+	return samples;
+}
+
+void RD::_sceneRenderPassCreate() {
+	bool multisampled = m_sampleCount != VK_SAMPLE_COUNT_1_BIT;
+
+	VkAttachmentDescription colorAttachmentDescription = {
+		.format = SCENE_FORMAT,
+		.samples = VK_SAMPLE_COUNT_1_BIT,
+		.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+		.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+		.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+		.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+	};
+
+	// samples are resolved at the end of the subpass and never written out
+	VkAttachmentDescription multisampleAttachmentDescription = {
+		.format = SCENE_FORMAT,
+		.samples = m_sampleCount,
+		.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+		.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+		.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+		.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+	};
+
+	if (multisampled)
+		colorAttachmentDescription.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+
+	VkAttachmentReference colorAttachmentReference = {
+		.attachment = 0,
+		.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+	};
+
+	VkAttachmentReference multisampleAttachmentReference = {
+		.attachment = 1,
+		.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+	};
+
+	VkSubpassDescription subpassDescription = {
+		.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+		.colorAttachmentCount = 1,
+		.pColorAttachments = &colorAttachmentReference,
+	};
+
+	if (multisampled) {
+		subpassDescription.pColorAttachments = &multisampleAttachmentReference;
+		subpassDescription.pResolveAttachments = &colorAttachmentReference;
+	}
+
+	// the previous upscale has to finish reading before the target is drawn over, and the next one
+	// has to wait for this pass to finish writing
+	VkSubpassDependency readDependency = {
+		.srcSubpass = VK_SUBPASS_EXTERNAL,
+		.dstSubpass = 0,
+		.srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+		.srcAccessMask = VK_ACCESS_NONE,
+		.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+	};
+
+	VkSubpassDependency writeDependency = {
+		.srcSubpass = 0,
+		.dstSubpass = VK_SUBPASS_EXTERNAL,
+		.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+		.dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+	};
+
+	VkAttachmentDescription attachments[2] = {
+		colorAttachmentDescription,
+		multisampleAttachmentDescription,
+	};
+
+	VkSubpassDependency dependencies[2] = {
+		readDependency,
+		writeDependency,
+	};
+
+	VkRenderPassCreateInfo renderPassInfo = {
+		.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+		.attachmentCount = multisampled ? 2u : 1u,
+		.pAttachments = attachments,
+		.subpassCount = 1,
+		.pSubpasses = &subpassDescription,
+		.dependencyCount = 2,
+		.pDependencies = dependencies,
+	};
+
+	CHECK_VK_RESULT(vkCreateRenderPass(m_context.device(), &renderPassInfo, nullptr, &m_sceneRenderPass) == VK_SUCCESS,
+			"Scene render pass creation failed!");
+}
+
+void RD::_sceneTargetCreate() {
+	// allocated at the full swapchain size; scaling only shrinks the rendered area
+	VkExtent2D extent = m_context.swapchainExtent();
+
+	if (_isPixelArt()) {
+		extent.width = m_virtualWidth;
+		extent.height = m_virtualHeight;
+	}
+	VkImageUsageFlags usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+
+	m_sceneImage = _imageCreate(extent.width, extent.height, 1, SCENE_FORMAT, usage, VK_SAMPLE_COUNT_1_BIT);
+	m_sceneImageView = _imageViewCreate(m_sceneImage.handle, 1, SCENE_FORMAT);
+	m_sceneExtent = extent;
+
+	uint32_t attachmentCount = 1;
+	VkImageView attachments[2] = {
+		m_sceneImageView,
+		VK_NULL_HANDLE,
+	};
+
+	if (m_sampleCount != VK_SAMPLE_COUNT_1_BIT) {
+		VkImageUsageFlags multisampleUsage =
+				VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+
+		m_sceneMultisampleImage =
+				_imageCreate(extent.width, extent.height, 1, SCENE_FORMAT, multisampleUsage, m_sampleCount);
+		m_sceneMultisampleImageView = _imageViewCreate(m_sceneMultisampleImage.handle, 1, SCENE_FORMAT);
+
+		attachments[1] = m_sceneMultisampleImageView;
+		attachmentCount = 2;
+	}
+
+	VkFramebufferCreateInfo framebufferInfo = {
+		.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+		.renderPass = m_sceneRenderPass,
+		.attachmentCount = attachmentCount,
+		.pAttachments = attachments,
+		.width = extent.width,
+		.height = extent.height,
+		.layers = 1,
+	};
+
+	CHECK_VK_RESULT(vkCreateFramebuffer(m_context.device(), &framebufferInfo, nullptr, &m_sceneFramebuffer) ==
+							VK_SUCCESS,
+			"Scene framebuffer creation failed!");
+
+	VkDescriptorImageInfo imageInfo = {
+		.imageView = m_sceneImageView,
+		.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+	};
+
+	VkWriteDescriptorSet imageWriteInfo = {
+		.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		.dstSet = m_sceneTextureSet,
+		.dstBinding = 1,
+		.descriptorCount = 1,
+		.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+		.pImageInfo = &imageInfo,
+	};
+
+	vkUpdateDescriptorSets(m_context.device(), 1, &imageWriteInfo, 0, nullptr);
+}
+
+void RD::_sceneTargetDestroy() {
+	vkDestroyFramebuffer(m_context.device(), m_sceneFramebuffer, nullptr);
+	_imageViewDestroy(m_sceneImageView);
+	_imageDestroy(m_sceneImage);
+
+	if (m_sampleCount != VK_SAMPLE_COUNT_1_BIT) {
+		_imageViewDestroy(m_sceneMultisampleImageView);
+		_imageDestroy(m_sceneMultisampleImage);
+	}
+}
+
+void RD::_scenePipelinesCreate() {
+	{
+		CheckerboardShader shader;
+		shader.compile(m_context.device());
+		m_checkerboardPipeline.handle = pipelineCreate(m_context.device(), shader.vertex(), shader.fragment(),
+				m_checkerboardPipeline.layout, m_sceneRenderPass, 0, m_sampleCount, true);
+	}
+
+	{
+		SpriteShader shader;
+		shader.compile(m_context.device());
+		m_spritePipeline.handle = pipelineCreate(m_context.device(), shader.vertex(), shader.fragment(),
+				m_spritePipeline.layout, m_sceneRenderPass, 0, m_sampleCount, true);
+	}
+
+	{
+		TiledSpriteShader shader;
+		shader.compile(m_context.device());
+		m_tiledSpritePipeline.handle = pipelineCreate(m_context.device(), shader.vertex(), shader.fragment(),
+				m_tiledSpritePipeline.layout, m_sceneRenderPass, 0, m_sampleCount, true);
+	}
+}
+
+void RD::_scenePipelinesDestroy() {
+	vkDestroyPipeline(m_context.device(), m_checkerboardPipeline.handle, nullptr);
+	vkDestroyPipeline(m_context.device(), m_spritePipeline.handle, nullptr);
+	vkDestroyPipeline(m_context.device(), m_tiledSpritePipeline.handle, nullptr);
+}
+
+void RD::_swapchainResize() {
+	// a minimized window has no surface to create a swapchain for, wait until it comes back
+	if (m_width == 0 || m_height == 0)
+		return;
+
+	m_context.windowResize(m_width, m_height);
+
+	// the last present went to the old swapchain, there is nothing left to wait for
+	m_framePending = false;
+
+	_sceneTargetDestroy();
+	_sceneTargetCreate();
+}
+
+bool RD::_isPixelArt() const {
+	return m_virtualWidth > 0 && m_virtualHeight > 0;
+}
+
+VkExtent2D RD::_renderExtent() const {
+	// the virtual resolution is already as small as it gets
+	if (_isPixelArt())
+		return m_sceneExtent;
+
+	float scale = m_resolutionScaler.scale();
+
+	uint32_t width = (uint32_t)(m_sceneExtent.width * scale + 0.5f);
+	uint32_t height = (uint32_t)(m_sceneExtent.height * scale + 0.5f);
+
+	VkExtent2D extent = {
+		.width = width > 0 ? width : 1,
+		.height = height > 0 ? height : 1,
+	};
+
+	return extent;
+}
+
+VkViewport RD::_outputViewport() const {
+	VkExtent2D extent = m_context.swapchainExtent();
+
+	VkViewport viewport = {
+		.width = (float)extent.width,
+		.height = (float)extent.height,
+		.minDepth = 0.0f,
+		.maxDepth = 1.0f,
+	};
+
+	if (!_isPixelArt())
+		return viewport;
+
+	// largest whole multiple that fits, centered with black bars around it
+	uint32_t scaleX = extent.width / m_sceneExtent.width;
+	uint32_t scaleY = extent.height / m_sceneExtent.height;
+
+	uint32_t scale = scaleX < scaleY ? scaleX : scaleY;
+	if (scale == 0)
+		scale = 1;
+
+	uint32_t width = m_sceneExtent.width * scale;
+	uint32_t height = m_sceneExtent.height * scale;
+
+	viewport.x = (float)(((int32_t)extent.width - (int32_t)width) / 2);
+	viewport.y = (float)(((int32_t)extent.height - (int32_t)height) / 2);
+	viewport.width = (float)width;
+	viewport.height = (float)height;
+
+	return viewport;
+}
+
+float RD::_gpuFrameTime(uint32_t frame) {
+	if (m_timestampPool == VK_NULL_HANDLE || !m_timestampsWritten[frame])
+		return 0.0f;
+
+	uint64_t timestamps[2];
+	VkResult result = vkGetQueryPoolResults(m_context.device(), m_timestampPool, frame * 2, 2, sizeof(timestamps),
+			timestamps, sizeof(timestamps[0]), VK_QUERY_RESULT_64_BIT);
+
+	// each measurement is read once, skipped frames must not count it again
+	m_timestampsWritten[frame] = false;
+
+	if (result != VK_SUCCESS || timestamps[1] < timestamps[0])
+		return 0.0f;
+
+	// nanoseconds to milliseconds
+	return (float)(timestamps[1] - timestamps[0]) * m_timestampPeriod / 1000000.0f;
+}
+
+VkInstance RD::instance() {
+	return m_context.instance();
+}
+
+void RD::frameWait() {
+	if (!m_framePacer.isEnabled() || !m_framePending)
+		return;
+
+	m_framePending = false;
+
+	uint32_t frame = (m_frame + m_framesInFlight - 1) % m_framesInFlight;
+	vkWaitForFences(m_context.device(), 1, &m_renderFences[frame], VK_TRUE, UINT64_MAX);
+	m_framePacer.frameFinished(currentTime());
+
+	// without present wait the GPU finishing is the closest thing to a present time there is
+	if (m_context.isPresentWaitSupported())
+		m_context.presentWait(m_presentId, PRESENT_WAIT_TIMEOUT);
+
+	m_framePacer.framePresented(currentTime());
+
+	sleepUntil(m_framePacer.nextFrameStart(currentTime()));
+	m_framePacer.frameStarted(currentTime());
+}
+
+bool RD::draw() {
+	_texturesUpdate();
+
+	// copies queued since the last frame go out together, minimized windows included
+	_uploadFlush();
+
+	if (m_width == 0 || m_height == 0)
+		return false;
+
+	VkCommandBuffer sceneCommandBuffer = m_sceneCommandBuffers[m_frame];
+	VkCommandBuffer outputCommandBuffer = m_outputCommandBuffers[m_frame];
+
+	CHECK_VK_RESULT(vkWaitForFences(m_context.device(), 1, &m_renderFences[m_frame], VK_TRUE, UINT64_MAX) == VK_SUCCESS,
+			"Fence timed out!");
+
+	m_resolutionScaler.update(_gpuFrameTime(m_frame));
+	_retiredTexturesCollect();
+
+	// staging retired with this fence is done now, it has to be let go before the fence is reset below
+	m_stagingPool.collect();
+
+	// refreshes the heap budgets the eviction goes by
+	vmaSetCurrentFrameIndex(m_allocator, (uint32_t)m_frameCount);
+
+	vkResetFences(m_context.device(), 1, &m_renderFences[m_frame]);
+
+	vkResetCommandBuffer(sceneCommandBuffer, 0);
+	vkResetCommandBuffer(outputCommandBuffer, 0);
+
+	VkExtent2D extent = m_context.swapchainExtent();
+	VkExtent2D renderExtent = _renderExtent();
+
+	// the projection stays in window pixels, the viewport maps it onto the scaled area
+	VkExtent2D viewExtent = _isPixelArt() ? m_sceneExtent : extent;
+	Matrix projection = projectionMatrix(viewExtent.width, viewExtent.height);
+
+	VkCommandBufferBeginInfo beginInfo = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+	};
+
+	vkBeginCommandBuffer(sceneCommandBuffer, &beginInfo);
+
+	if (m_timestampPool != VK_NULL_HANDLE) {
+		vkCmdResetQueryPool(sceneCommandBuffer, m_timestampPool, m_frame * 2, 2);
+		vkCmdWriteTimestamp(sceneCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_timestampPool, m_frame * 2);
+	}
+
+	_uploadPoll(sceneCommandBuffer);
+	bool refreshed = _reloadsUpdate(sceneCommandBuffer);
+
+	std::unordered_map<uint32_t, TextureEntry>::iterator shown = m_textures.find(m_shownTexture);
+
+	// pages are copied outside the render pass, before the sprite samples them; while a reload of another size
+	// uploads, the image no longer matches the cache and the pages already there have to do
+	m_pagesPending = false;
+	if (shown != m_textures.end() && shown->second.tiled && !shown->second.replacing)
+		_pagesStream(sceneCommandBuffer, shown->second, viewExtent);
+
+	VkClearValue clearValue = {
+		.color = { { 0.0f, 0.0f, 0.0f, 1.0f } },
+	};
+
+	// scene
+
+	{
+		VkViewport viewport = {
+			.width = (float)renderExtent.width,
+			.height = (float)renderExtent.height,
+			.minDepth = 0.0f,
+			.maxDepth = 1.0f,
+		};
+
+		VkRect2D scissor = {
+			.extent = renderExtent,
+		};
+
+		// the multisampled attachment, when there is one, comes second
+		VkClearValue clearValues[2] = {
+			clearValue,
+			clearValue,
+		};
+
+		VkRenderPassBeginInfo renderPassInfo = {
+			.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+			.renderPass = m_sceneRenderPass,
+			.framebuffer = m_sceneFramebuffer,
+			.renderArea = scissor,
+			.clearValueCount = 2,
+			.pClearValues = clearValues,
+		};
+
+		vkCmdBeginRenderPass(sceneCommandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+		vkCmdSetViewport(sceneCommandBuffer, 0, 1, &viewport);
+		vkCmdSetScissor(sceneCommandBuffer, 0, 1, &scissor);
+
+		vkCmdBindPipeline(sceneCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_checkerboardPipeline.handle);
+		vkCmdDraw(sceneCommandBuffer, 3, 1, 0, 0);
+
+		if (shown != m_textures.end()) {
+			const Texture &texture = shown->second.texture;
+			shown->second.lastUsedFrame = m_frameCount;
+
+			const Pipeline &pipeline = shown->second.tiled ? m_tiledSpritePipeline : m_spritePipeline;
+			vkCmdBindPipeline(sceneCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.handle);
+
+			VkDescriptorSet descriptorSets[] = {
+				m_uniformSets[m_frame],
+				texture.set,
+			};
+
+			vkCmdBindDescriptorSets(sceneCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.layout, 0, 2,
+					descriptorSets, 0, nullptr);
+
+			Matrix model = modelMatrix(m_spriteX, m_spriteY, m_spriteRotation, texture.width, texture.height);
+
+			if (shown->second.tiled) {
+				TiledObjectConstants constants;
+				memcpy(constants.modelMatrix, model.data, sizeof(model.data));
+				constants.imageSize[0] = (float)texture.width;
+				constants.imageSize[1] = (float)texture.height;
+
+				vkCmdPushConstants(sceneCommandBuffer, pipeline.layout,
+						VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(constants), &constants);
+			} else {
+				ObjectConstants constants;
+				memcpy(constants.modelMatrix, model.data, sizeof(model.data));
+
+				vkCmdPushConstants(sceneCommandBuffer, pipeline.layout, VK_SHADER_STAGE_VERTEX_BIT, 0,
+						sizeof(constants), &constants);
+			}
+
+			vkCmdDraw(sceneCommandBuffer, 6, 1, 0, 0);
+		}
+
+		vkCmdEndRenderPass(sceneCommandBuffer);
+	}
+
+	// the output pass waits for a swapchain image, timing it would count the wait for vsync as rendering
+	if (m_timestampPool != VK_NULL_HANDLE) {
+		vkCmdWriteTimestamp(sceneCommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_timestampPool, m_frame * 2 + 1);
+		m_timestampsWritten[m_frame] = true;
+	}
+
+	vkEndCommandBuffer(sceneCommandBuffer);
+
+	// latched as late as possible, so the camera reflects the newest input
+	Matrix view = viewMatrix(m_cameraX, m_cameraY);
+
+	SceneUBO ubo;
+	memcpy(ubo.projectionMatrix, projection.data, sizeof(projection.data));
+	memcpy(ubo.viewMatrix, view.data, sizeof(view.data));
+
+	memcpy(m_uniformBufferAllocInfos[m_frame].pMappedData, &ubo, sizeof(ubo));
+	vmaFlushAllocation(m_allocator, m_uniformBuffers[m_frame].allocation, 0, VK_WHOLE_SIZE);
+
+	// the scene does not need a swapchain image, the GPU can start on it while we wait for one
+	VkSubmitInfo sceneSubmitInfo = {
+		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		.commandBufferCount = 1,
+		.pCommandBuffers = &sceneCommandBuffer,
+	};
+
+	vkQueueSubmit(m_context.graphicsQueue(), 1, &sceneSubmitInfo, VK_NULL_HANDLE);
+	m_frameCount += 1;
+
+	uint32_t imageIndex = 0;
+	VkResult result = vkAcquireNextImageKHR(m_context.device(), m_context.swapchain(), UINT64_MAX,
+			m_presentSemaphores[m_frame], VK_NULL_HANDLE, &imageIndex);
+
+	if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+		// the fence still guards the scene that was already submitted
+		vkQueueSubmit(m_context.graphicsQueue(), 0, nullptr, m_renderFences[m_frame]);
+
+		if (refreshed)
+			m_stagingPool.retire(m_renderFences[m_frame]);
+
+		if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+			// nothing was acquired, the frame is retried on the new swapchain
+			_swapchainResize();
+			m_resized = false;
+		} else {
+			printf("Swapchain image acquire failed!\n");
+		}
+
+		return false;
+	}
 
-	vkCmdBeginRenderPass(m_commandBuffers[m_frame], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	vkBeginCommandBuffer(outputCommandBuffer, &beginInfo);
 
-	vkCmdSetViewport(m_commandBuffers[m_frame], 0, 1, &viewport);
-	vkCmdSetScissor(m_commandBuffers[m_frame], 0, 1, &scissor);
+	// upscale and post filter
 
-	vkCmdBindPipeline(m_commandBuffers[m_frame], VK_PIPELINE_BIND_POINT_GRAPHICS, m_checkerboardPipeline.handle);
-	vkCmdDraw(m_commandBuffers[m_frame], 3, 1, 0, 0);
+	{
+		VkViewport viewport = _outputViewport();
 
-	if (m_imageValid) {
-		vkCmdBindPipeline(m_commandBuffers[m_frame], VK_PIPELINE_BIND_POINT_GRAPHICS, m_spritePipeline.handle);
+		VkRect2D scissor = {
+			.extent = extent,
+		};
 
-		VkDescriptorSet descriptorSets[] = {
-			m_uniformSets[m_frame],
-			m_textureSet,
+		VkRenderPassBeginInfo renderPassInfo = {
+			.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+			.renderPass = m_context.renderPass(),
+			.framebuffer = m_context.framebuffer(imageIndex),
+			.renderArea = scissor,
+			.clearValueCount = 1,
+			.pClearValues = &clearValue,
 		};
 
-		vkCmdBindDescriptorSets(m_commandBuffers[m_frame], VK_PIPELINE_BIND_POINT_GRAPHICS, m_spritePipeline.layout, 0,
-				2, descriptorSets, 0, nullptr);
+		vkCmdBeginRenderPass(outputCommandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+		vkCmdSetViewport(outputCommandBuffer, 0, 1, &viewport);
+		vkCmdSetScissor(outputCommandBuffer, 0, 1, &scissor);
+
+		Pipeline postPipeline = m_upscalePipeline;
+		if (_isPixelArt()) {
+			postPipeline = m_nearestPipeline;
+		} else if (m_antiAliasing == ANTI_ALIASING_FXAA) {
+			postPipeline = m_fxaaPipeline;
+		}
+
+		vkCmdBindPipeline(outputCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, postPipeline.handle);
+		vkCmdBindDescriptorSets(outputCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, postPipeline.layout, 0, 1,
+				&m_sceneTextureSet, 0, nullptr);
 
-		Matrix model = modelMatrix(0.0, 0.0, 0.0, m_imageWidth, m_imageHeight);
+		PostConstants constants = {
+			.sourceSize = { (float)renderExtent.width, (float)renderExtent.height },
+			.targetSize = { (float)m_sceneExtent.width, (float)m_sceneExtent.height },
+		};
 
-		ObjectConstants constants;
-		memcpy(constants.modelMatrix, model.data, sizeof(model.data));
+		vkCmdPushConstants(outputCommandBuffer, postPipeline.layout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(constants),
+				&constants);
 
-		vkCmdPushConstants(m_commandBuffers[m_frame], m_spritePipeline.layout, VK_SHADER_STAGE_VERTEX_BIT, 0,
-				sizeof(constants), &constants);
+		vkCmdDraw(outputCommandBuffer, 3, 1, 0, 0);
 
-		vkCmdDraw(m_commandBuffers[m_frame], 6, 1, 0, 0);
+		vkCmdEndRenderPass(outputCommandBuffer);
 	}
 
-	vkCmdEndRenderPass(m_commandBuffers[m_frame]);
-	vkEndCommandBuffer(m_commandBuffers[m_frame]);
+	vkEndCommandBuffer(outputCommandBuffer);
 
 	VkPipelineStageFlags waitDstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 
@@ -469,17 +1941,47 @@ void RD::draw() {
 		.pWaitSemaphores = &m_presentSemaphores[m_frame],
 		.pWaitDstStageMask = &waitDstStageMask,
 		.commandBufferCount = 1,
-		.pCommandBuffers = &m_commandBuffers[m_frame],
+		.pCommandBuffers = &outputCommandBuffer,
 		.signalSemaphoreCount = 1,
 		.pSignalSemaphores = &m_renderSemaphores[m_frame],
 	};
 
 	vkQueueSubmit(m_context.graphicsQueue(), 1, &submitInfo, m_renderFences[m_frame]);
 
+	// only a submitted fence can be waited on when the pool runs full
+	if (refreshed)
+		m_stagingPool.retire(m_renderFences[m_frame]);
+
 	VkSwapchainKHR swapchain = m_context.swapchain();
+	VkPresentModeKHR presentMode = m_context.presentMode();
+
+	VkSwapchainPresentModeInfoEXT presentModeInfo = {
+		.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_PRESENT_MODE_INFO_EXT,
+		.swapchainCount = 1,
+		.pPresentModes = &presentMode,
+	};
+
+	VkPresentIdKHR presentIdInfo = {
+		.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR,
+		.swapchainCount = 1,
+		.pPresentIds = &m_presentId,
+	};
+
+	const void *presentNext = nullptr;
+
+	if (m_context.isPresentModeSwitchable())
+		presentNext = &presentModeInfo;
+
+	if (m_context.isPresentWaitSupported()) {
+		m_presentId += 1;
+
+		presentIdInfo.pNext = presentNext;
+		presentNext = &presentIdInfo;
+	}
 
 	VkPresentInfoKHR presentInfo = {
 		.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+		.pNext = presentNext,
 		.waitSemaphoreCount = 1,
 		.pWaitSemaphores = &m_renderSemaphores[m_frame],
 		.swapchainCount = 1,
@@ -488,53 +1990,117 @@ void RD::draw() {
 	};
 
 	result = vkQueuePresentKHR(m_context.presentQueue(), &presentInfo);
+	m_framePending = true;
 
 	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || m_resized) {
-		m_context.windowResize(m_width, m_height);
+		_swapchainResize();
 		m_resized = false;
 	} else if (result != VK_SUCCESS) {
 		printf("Swapchain image presentation failed!\n");
 	}
 
-	m_frame = (m_frame + 1) % FRAMES_IN_FLIGHT;
+	m_frame = (m_frame + 1) % m_framesInFlight;
+	return true;
 }
 
-void RD::spriteCreate(Image *image) {
-	vkDeviceWaitIdle(m_context.device());
+void RD::textureCreate(uint32_t texture, Image &&image, TextureFilter filter) {
+	TextureEntry &entry = m_textures[texture];
+	entry.image = std::move(image);
+	entry.filter = filter;
+	entry.resident = false;
+	entry.serial = 0;
+	entry.lastUsedFrame = 0;
+	entry.refreshing = false;
+	entry.replacing = false;
+}
+
+void RD::textureDestroy(uint32_t texture) {
+	std::unordered_map<uint32_t, TextureEntry>::iterator entry = m_textures.find(texture);
+	if (entry == m_textures.end())
+		return;
+
+	// a copy still on its way is dropped along with it
+	_textureRelease(entry->second);
+	m_textures.erase(entry);
+
+	if (m_shownTexture == texture)
+		m_shownTexture = 0;
+
+	// a sprite still waiting for it stays with what it shows now
+	if (m_spriteTexture == texture)
+		m_spriteTexture = m_shownTexture;
+}
+
+void RD::textureUpdate(uint32_t texture, Image &&image) {
+	std::unordered_map<uint32_t, TextureEntry>::iterator reloaded = m_textures.find(texture);
+	if (reloaded == m_textures.end())
+		return;
+
+	TextureEntry &entry = reloaded->second;
+
+	bool sameLayout = image.width() == entry.image.width() && image.height() == entry.image.height() &&
+			image.mipLevels() == entry.image.mipLevels() && image.format() == entry.image.format() &&
+			image.colorSpace() == entry.image.colorSpace();
+
+	entry.image = std::move(image);
 
-	if (m_imageValid) {
-		vkDestroyImageView(m_context.device(), m_imageView, nullptr);
-		vmaDestroyImage(m_allocator, m_image.handle, m_image.allocation);
+	// uploaded from the new image whenever it is drawn next
+	if (!entry.resident)
+		return;
+
+	bool listed = entry.refreshing || entry.replacing;
+
+	// the texture matches the new pixels as it is, a frame copies them over the old ones
+	if (sameLayout && !entry.tiled && !entry.replacing && entry.serial <= m_completedUploadSerial) {
+		entry.refreshing = true;
+
+		if (!listed)
+			m_reloadedTextures.push_back(texture);
+
+		return;
 	}
 
-	VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
-	VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	entry.refreshing = false;
 
-	m_image = _imageCreate(image->width(), image->height(), format, usage);
-	m_imageView = _imageViewCreate(m_image.handle, format);
+	if (!_isTiled(entry.image) && m_textureCount < MAX_TEXTURES) {
+		// a reload of another size still uploading is superseded
+		if (entry.replacing) {
+			_textureDiscard(entry.replacement, entry.replacementSerial);
+			entry.replacing = false;
+		}
 
-	m_imageWidth = image->width();
-	m_imageHeight = image->height();
+		if (_textureUpload(entry.image, entry.filter, &entry.replacement)) {
+			entry.replacing = true;
+			entry.replacementSerial = m_uploadSerial + 1;
 
-	_imageUpdate(m_image.handle, image->width(), image->height(), format, image->data(), image->size());
+			if (!listed)
+				m_reloadedTextures.push_back(texture);
 
-	VkDescriptorImageInfo imageInfo = {
-		.imageView = m_imageView,
-		.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-	};
+			return;
+		}
+	}
 
-	VkWriteDescriptorSet imageWriteInfo = {
-		.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-		.dstSet = m_textureSet,
-		.dstBinding = 1,
-		.descriptorCount = 1,
-		.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
-		.pImageInfo = &imageInfo,
-	};
+	// tiled images get a new cache right away, anything else that cannot be replaced in place is uploaded again
+	// like an evicted texture
+	_textureRelease(entry);
 
-	vkUpdateDescriptorSets(m_context.device(), 1, &imageWriteInfo, 0, nullptr);
+	if (m_shownTexture == texture)
+		m_shownTexture = 0;
+}
+
+void RD::spriteTextureSet(uint32_t texture) {
+	if (texture != 0 && m_textures.count(texture) == 0)
+		return;
 
-	m_imageValid = true;
+	m_spriteTexture = texture;
+
+	if (texture == 0)
+		m_shownTexture = 0;
+}
+
+bool RD::isUploadPending() const {
+	return m_spriteTexture != m_shownTexture || m_pagesPending || !m_reloadedTextures.empty() ||
+			m_uploadBatchCount > 0 || !m_bufferUploads.empty() || !m_imageUploads.empty();
 }
 
 void RD::windowCreate(VkSurfaceKHR surface, uint32_t width, uint32_t height) {
@@ -552,9 +2118,14 @@ void RD::windowCreate(VkSurfaceKHR surface, uint32_t width, uint32_t height) {
 		allocatorInfo.physicalDevice = m_context.physicalDevice();
 		allocatorInfo.device = m_context.device();
 
+		if (m_context.isMemoryBudgetSupported())
+			allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+
 		CHECK_VK_RESULT(vmaCreateAllocator(&allocatorInfo, &m_allocator) == VK_SUCCESS, "Allocator creation failed!");
 	}
 
+	m_stagingPool.create(m_context.device(), m_allocator, STAGING_CHUNK_SIZE, m_stagingMemoryCap);
+
 	// commands
 
 	{
@@ -562,10 +2133,12 @@ void RD::windowCreate(VkSurfaceKHR surface, uint32_t width, uint32_t height) {
 			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
 			.commandPool = m_context.commandPool(),
 			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-			.commandBufferCount = FRAMES_IN_FLIGHT,
+			.commandBufferCount = MAX_FRAMES_IN_FLIGHT,
 		};
 
-		CHECK_VK_RESULT(vkAllocateCommandBuffers(m_context.device(), &allocInfo, m_commandBuffers) == VK_SUCCESS,
+		CHECK_VK_RESULT(vkAllocateCommandBuffers(m_context.device(), &allocInfo, m_sceneCommandBuffers) == VK_SUCCESS,
+				"Command buffers allocation failed!");
+		CHECK_VK_RESULT(vkAllocateCommandBuffers(m_context.device(), &allocInfo, m_outputCommandBuffers) == VK_SUCCESS,
 				"Command buffers allocation failed!");
 	}
 
@@ -581,18 +2154,23 @@ void RD::windowCreate(VkSurfaceKHR surface, uint32_t width, uint32_t height) {
 			.flags = VK_FENCE_CREATE_SIGNALED_BIT,
 		};
 
-		for (uint32_t i = 0; i < FRAMES_IN_FLIGHT; i++) {
+		for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
 			vkCreateSemaphore(m_context.device(), &semaphoreInfo, nullptr, &m_presentSemaphores[i]);
 			vkCreateSemaphore(m_context.device(), &semaphoreInfo, nullptr, &m_renderSemaphores[i]);
 			vkCreateFence(m_context.device(), &fenceInfo, nullptr, &m_renderFences[i]);
 		}
+
+		fenceInfo.flags = 0;
+
+		for (uint32_t i = 0; i < MAX_UPLOAD_BATCHES; i++)
+			vkCreateFence(m_context.device(), &fenceInfo, nullptr, &m_uploadBatches[i].fence);
 	}
 
 	// descriptor pool
 
 	{
 		VkDescriptorPoolSize poolSizes[] = {
-			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, FRAMES_IN_FLIGHT },
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, MAX_FRAMES_IN_FLIGHT },
 			{ VK_DESCRIPTOR_TYPE_SAMPLER, 1 },
 			{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1 },
 		};
@@ -614,6 +2192,28 @@ void RD::windowCreate(VkSurfaceKHR surface, uint32_t width, uint32_t height) {
 				"Descriptor pool creation failed!");
 	}
 
+	// texture descriptor pool, sets come and go with their textures
+
+	{
+		VkDescriptorPoolSize poolSizes[] = {
+			{ VK_DESCRIPTOR_TYPE_SAMPLER, MAX_TEXTURES },
+			// tiled textures bind their page table next to the cache
+			{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 2 * MAX_TEXTURES },
+		};
+
+		VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+			.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
+			.maxSets = MAX_TEXTURES,
+			.poolSizeCount = sizeof(poolSizes) / sizeof(poolSizes[0]),
+			.pPoolSizes = poolSizes,
+		};
+
+		CHECK_VK_RESULT(vkCreateDescriptorPool(m_context.device(), &descriptorPoolCreateInfo, nullptr,
+								&m_textureDescriptorPool) == VK_SUCCESS,
+				"Descriptor pool creation failed!");
+	}
+
 	// uniform buffers
 
 	{
@@ -634,23 +2234,23 @@ void RD::windowCreate(VkSurfaceKHR surface, uint32_t width, uint32_t height) {
 								VK_SUCCESS,
 				"Uniform set layout creation failed!");
 
-		VkDescriptorSetLayout uniformSetLayouts[FRAMES_IN_FLIGHT];
-		for (uint32_t i = 0; i < FRAMES_IN_FLIGHT; i++) {
+		VkDescriptorSetLayout uniformSetLayouts[MAX_FRAMES_IN_FLIGHT];
+		for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
 			uniformSetLayouts[i] = m_uniformSetLayout;
 		}
 
 		VkDescriptorSetAllocateInfo uniformSetAllocInfo = {
 			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
 			.descriptorPool = m_descriptorPool,
-			.descriptorSetCount = FRAMES_IN_FLIGHT,
+			.descriptorSetCount = MAX_FRAMES_IN_FLIGHT,
 			.pSetLayouts = uniformSetLayouts,
 		};
 
 		CHECK_VK_RESULT(vkAllocateDescriptorSets(m_context.device(), &uniformSetAllocInfo, m_uniformSets) == VK_SUCCESS,
 				"Uniform sets allocation failed!");
 
-		m_uniformBufferAllocInfos = new VmaAllocationInfo[FRAMES_IN_FLIGHT];
-		for (uint32_t i = 0; i < FRAMES_IN_FLIGHT; i++) {
+		m_uniformBufferAllocInfos = new VmaAllocationInfo[MAX_FRAMES_IN_FLIGHT];
+		for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
 			size_t size = sizeof(SceneUBO);
 			VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
 
@@ -696,6 +2296,18 @@ void RD::windowCreate(VkSurfaceKHR surface, uint32_t width, uint32_t height) {
 
 		CHECK_VK_RESULT(vkCreateSampler(m_context.device(), &samplerInfo, nullptr, &m_sampler) == VK_SUCCESS,
 				"Sampler creation failed!");
+
+		samplerInfo.magFilter = VK_FILTER_LINEAR;
+		samplerInfo.minFilter = VK_FILTER_LINEAR;
+
+		CHECK_VK_RESULT(vkCreateSampler(m_context.device(), &samplerInfo, nullptr, &m_linearSampler) == VK_SUCCESS,
+				"Sampler creation failed!");
+
+		// scaled down sprites read from the smaller levels, blended between the two closest
+		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+
+		CHECK_VK_RESULT(vkCreateSampler(m_context.device(), &samplerInfo, nullptr, &m_trilinearSampler) == VK_SUCCESS,
+				"Sampler creation failed!");
 	}
 
 	// image
@@ -737,16 +2349,18 @@ void RD::windowCreate(VkSurfaceKHR surface, uint32_t width, uint32_t height) {
 			.pSetLayouts = &m_textureSetLayout,
 		};
 
-		CHECK_VK_RESULT(vkAllocateDescriptorSets(m_context.device(), &uniformSetAllocInfo, &m_textureSet) == VK_SUCCESS,
-				"Texture set allocation failed!");
+		CHECK_VK_RESULT(vkAllocateDescriptorSets(m_context.device(), &uniformSetAllocInfo, &m_sceneTextureSet) ==
+								VK_SUCCESS,
+				"Scene texture set allocation failed!");
 
+		// post filters read the scene between texels
 		VkDescriptorImageInfo samplerInfo = {
-			.sampler = m_sampler,
+			.sampler = m_linearSampler,
 		};
 
 		VkWriteDescriptorSet samplerWriteInfo = {
 			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-			.dstSet = m_textureSet,
+			.dstSet = m_sceneTextureSet,
 			.dstBinding = 0,
 			.descriptorCount = 1,
 			.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER,
@@ -756,6 +2370,75 @@ void RD::windowCreate(VkSurfaceKHR surface, uint32_t width, uint32_t height) {
 		vkUpdateDescriptorSets(m_context.device(), 1, &samplerWriteInfo, 0, nullptr);
 	}
 
+	// tiled image
+
+	{
+		VkDescriptorSetLayoutBinding samplerBinding = {
+			.binding = 0,
+			.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+		};
+
+		VkDescriptorSetLayoutBinding cacheBinding = {
+			.binding = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+		};
+
+		VkDescriptorSetLayoutBinding tableBinding = {
+			.binding = 2,
+			.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+		};
+
+		VkDescriptorSetLayoutBinding bindings[] = {
+			samplerBinding,
+			cacheBinding,
+			tableBinding,
+		};
+
+		VkDescriptorSetLayoutCreateInfo createInfo = {
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+			.bindingCount = 3,
+			.pBindings = bindings,
+		};
+
+		CHECK_VK_RESULT(vkCreateDescriptorSetLayout(
+								m_context.device(), &createInfo, nullptr, &m_tiledTextureSetLayout) == VK_SUCCESS,
+				"Tiled texture set layout creation failed!");
+	}
+
+	// scene target
+
+	m_sampleCount = _sampleCount(m_antiAliasing);
+	_sceneRenderPassCreate();
+	_sceneTargetCreate();
+
+	// timestamps
+
+	{
+		VkPhysicalDeviceProperties properties = m_context.properties();
+
+		if (properties.limits.timestampComputeAndGraphics) {
+			VkQueryPoolCreateInfo createInfo = {
+				.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+				.queryType = VK_QUERY_TYPE_TIMESTAMP,
+				.queryCount = MAX_FRAMES_IN_FLIGHT * 2,
+			};
+
+			CHECK_VK_RESULT(vkCreateQueryPool(m_context.device(), &createInfo, nullptr, &m_timestampPool) ==
+									VK_SUCCESS,
+					"Timestamp query pool creation failed!");
+
+			m_timestampPeriod = properties.limits.timestampPeriod;
+		} else {
+			printf("GPU timestamps not supported, dynamic resolution disabled!\n");
+		}
+	}
+
 	// checkerboard pipeline
 
 	{
@@ -766,11 +2449,6 @@ void RD::windowCreate(VkSurfaceKHR surface, uint32_t width, uint32_t height) {
 		CHECK_VK_RESULT(vkCreatePipelineLayout(
 								m_context.device(), &createInfo, nullptr, &m_checkerboardPipeline.layout) == VK_SUCCESS,
 				"Pipeline layout creation failed!");
-
-		CheckerboardShader shader;
-		shader.compile(m_context.device());
-		m_checkerboardPipeline.handle = pipelineCreate(m_context.device(), shader.vertex(), shader.fragment(),
-				m_checkerboardPipeline.layout, m_context.renderPass(), 0);
 	}
 
 	// sprite pipeline
@@ -797,11 +2475,86 @@ void RD::windowCreate(VkSurfaceKHR surface, uint32_t width, uint32_t height) {
 		CHECK_VK_RESULT(vkCreatePipelineLayout(m_context.device(), &createInfo, nullptr, &m_spritePipeline.layout) ==
 								VK_SUCCESS,
 				"Pipeline layout creation failed!");
+	}
 
-		SpriteShader shader;
+	// tiled sprite pipeline
+
+	{
+		// the fragment shader finds pages from the image size
+		VkPushConstantRange pushConstantRange = {
+			.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+			.size = sizeof(TiledObjectConstants),
+		};
+
+		VkDescriptorSetLayout setLayouts[] = {
+			m_uniformSetLayout,
+			m_tiledTextureSetLayout,
+		};
+
+		VkPipelineLayoutCreateInfo createInfo = {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+			.setLayoutCount = 2,
+			.pSetLayouts = setLayouts,
+			.pushConstantRangeCount = 1,
+			.pPushConstantRanges = &pushConstantRange,
+		};
+
+		CHECK_VK_RESULT(vkCreatePipelineLayout(
+								m_context.device(), &createInfo, nullptr, &m_tiledSpritePipeline.layout) == VK_SUCCESS,
+				"Pipeline layout creation failed!");
+	}
+
+	// scene pipelines
+
+	_scenePipelinesCreate();
+
+	// upscale pipeline
+
+	{
+		VkPushConstantRange pushConstantRange = {
+			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+			.size = sizeof(PostConstants),
+		};
+
+		VkPipelineLayoutCreateInfo createInfo = {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+			.setLayoutCount = 1,
+			.pSetLayouts = &m_textureSetLayout,
+			.pushConstantRangeCount = 1,
+			.pPushConstantRanges = &pushConstantRange,
+		};
+
+		CHECK_VK_RESULT(vkCreatePipelineLayout(m_context.device(), &createInfo, nullptr, &m_upscalePipeline.layout) ==
+								VK_SUCCESS,
+				"Pipeline layout creation failed!");
+
+		UpscaleShader shader;
 		shader.compile(m_context.device());
-		m_spritePipeline.handle = pipelineCreate(m_context.device(), shader.vertex(), shader.fragment(),
-				m_spritePipeline.layout, m_context.renderPass(), 0);
+		m_upscalePipeline.handle = pipelineCreate(m_context.device(), shader.vertex(), shader.fragment(),
+				m_upscalePipeline.layout, m_context.renderPass(), 0, VK_SAMPLE_COUNT_1_BIT, false);
+	}
+
+	// fxaa pipeline
+
+	{
+		// same inputs as the upscale pass
+		m_fxaaPipeline.layout = m_upscalePipeline.layout;
+
+		FxaaShader shader;
+		shader.compile(m_context.device());
+		m_fxaaPipeline.handle = pipelineCreate(m_context.device(), shader.vertex(), shader.fragment(),
+				m_fxaaPipeline.layout, m_context.renderPass(), 0, VK_SAMPLE_COUNT_1_BIT, false);
+	}
+
+	// nearest pipeline
+
+	{
+		m_nearestPipeline.layout = m_upscalePipeline.layout;
+
+		NearestShader shader;
+		shader.compile(m_context.device());
+		m_nearestPipeline.handle = pipelineCreate(m_context.device(), shader.vertex(), shader.fragment(),
+				m_nearestPipeline.layout, m_context.renderPass(), 0, VK_SAMPLE_COUNT_1_BIT, false);
 	}
 
 	m_initialized = true;
@@ -816,6 +2569,123 @@ void RD::windowResize(uint32_t width, uint32_t height) {
 	m_resized = true;
 }
 
+void RD::renderScaleSet(float scale) {
+	m_resolutionScaler.enabledSet(false);
+	m_resolutionScaler.scaleSet(scale);
+}
+
+void RD::dynamicResolutionSet(bool enabled, float targetFrameTime) {
+	m_resolutionScaler.targetFrameTimeSet(targetFrameTime);
+	m_resolutionScaler.enabledSet(enabled);
+}
+
+void RD::antiAliasingSet(AntiAliasing antiAliasing) {
+	m_antiAliasing = antiAliasing;
+
+	if (!m_initialized)
+		return;
+
+	VkSampleCountFlagBits samples = _sampleCount(antiAliasing);
+	if (samples == m_sampleCount)
+		return;
+
+	// sample count is baked into the render pass, the target and the scene pipelines
+	vkDeviceWaitIdle(m_context.device());
+
+	_scenePipelinesDestroy();
+	_sceneTargetDestroy();
+	vkDestroyRenderPass(m_context.device(), m_sceneRenderPass, nullptr);
+
+	m_sampleCount = samples;
+
+	_sceneRenderPassCreate();
+	_sceneTargetCreate();
+	_scenePipelinesCreate();
+}
+
+void RD::virtualResolutionSet(uint32_t width, uint32_t height) {
+	if (width == 0 || height == 0) {
+		width = 0;
+		height = 0;
+	}
+
+	if (width == m_virtualWidth && height == m_virtualHeight)
+		return;
+
+	m_virtualWidth = width;
+	m_virtualHeight = height;
+
+	if (!m_initialized)
+		return;
+
+	vkDeviceWaitIdle(m_context.device());
+
+	_sceneTargetDestroy();
+	_sceneTargetCreate();
+}
+
+void RD::presentModeSet(PresentMode presentMode) {
+	// modes outside the current compatibility group need a new swapchain
+	if (!m_context.presentModeSet(vulkanPresentMode(presentMode)))
+		m_resized = true;
+}
+
+void RD::swapchainImageCountSet(uint32_t imageCount) {
+	m_context.imageCountSet(imageCount);
+
+	if (m_initialized)
+		m_resized = true;
+}
+
+void RD::framesInFlightSet(uint32_t framesInFlight) {
+	if (framesInFlight < 1) {
+		framesInFlight = 1;
+	} else if (framesInFlight > MAX_FRAMES_IN_FLIGHT) {
+		framesInFlight = MAX_FRAMES_IN_FLIGHT;
+	}
+
+	if (framesInFlight == m_framesInFlight)
+		return;
+
+	// resources exist for the deepest queue, only the rotation changes
+	if (m_initialized)
+		vkDeviceWaitIdle(m_context.device());
+
+	m_framesInFlight = framesInFlight;
+	m_frame = 0;
+}
+
+void RD::framePacingSet(bool enabled) {
+	m_framePacer.enabledSet(enabled);
+	m_framePacer.frameStarted(currentTime());
+}
+
+void RD::refreshRateSet(float refreshRate) {
+	m_framePacer.refreshRateSet(refreshRate);
+}
+
+void RD::stagingMemoryCapSet(size_t size) {
+	m_stagingMemoryCap = size;
+
+	if (m_initialized)
+		m_stagingPool.memoryCapSet(size);
+}
+
+void RD::textureMemoryCapSet(size_t size) {
+	m_textureMemoryCap = size;
+}
+
+void RD::cameraSet(float x, float y) {
+	m_cameraX = x;
+	m_cameraY = y;
+}
+
+void RD::spriteTransformSet(float x, float y, float rotation) {
+	m_spriteX = x;
+	m_spriteY = y;
+	m_spriteRotation = rotation;
+}
+
 void RD::create(const char *const *extensions, uint32_t extensionCount, bool validation) {
 	m_context.create(extensions, extensionCount, validation);
 }
@@ -824,12 +2694,66 @@ void RD::destroy() {
 	vkDeviceWaitIdle(m_context.device());
 
 	if (m_initialized) {
-		for (uint32_t i = 0; i < FRAMES_IN_FLIGHT; i++) {
+		for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
 			vkDestroySemaphore(m_context.device(), m_presentSemaphores[i], nullptr);
 			vkDestroySemaphore(m_context.device(), m_renderSemaphores[i], nullptr);
 			vkDestroyFence(m_context.device(), m_renderFences[i], nullptr);
 		}
 
+		_scenePipelinesDestroy();
+		_sceneTargetDestroy();
+		vkDestroyRenderPass(m_context.device(), m_sceneRenderPass, nullptr);
+
+		if (m_timestampPool != VK_NULL_HANDLE)
+			vkDestroyQueryPool(m_context.device(), m_timestampPool, nullptr);
+
+		for (uint32_t i = 0; i < m_uploadBatchCount; i++) {
+			UploadBatch &batch = m_uploadBatches[(m_uploadBatchFirst + i) % MAX_UPLOAD_BATCHES];
+			vkFreeCommandBuffers(m_context.device(), m_context.transferCommandPool(), 1, &batch.commandBuffer);
+		}
+
+		for (uint32_t i = 0; i < MAX_UPLOAD_BATCHES; i++)
+			vkDestroyFence(m_context.device(), m_uploadBatches[i].fence, nullptr);
+
+		m_uploadBatchCount = 0;
+		m_bufferUploads.clear();
+		m_imageUploads.clear();
+
+		for (const DiscardedTexture &discarded : m_discardedTextures)
+			_textureDestroy(discarded.texture);
+
+		m_discardedTextures.clear();
+
+		for (const RetiredTexture &retired : m_retiredTextures)
+			_textureDestroy(retired.texture);
+
+		m_retiredTextures.clear();
+
+		for (std::unordered_map<uint32_t, TextureEntry>::iterator it = m_textures.begin(); it != m_textures.end();
+				++it) {
+			if (it->second.resident)
+				_textureDestroy(it->second.texture);
+
+			if (it->second.replacing)
+				_textureDestroy(it->second.replacement);
+		}
+
+		m_textures.clear();
+		m_reloadedTextures.clear();
+		m_spriteTexture = 0;
+		m_shownTexture = 0;
+
+		if (m_pageStagingCreated) {
+			for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+				_bufferDestroy(m_pageStagingBuffers[i]);
+
+			m_pageStagingCreated = false;
+		}
+
+		vkDestroyDescriptorPool(m_context.device(), m_textureDescriptorPool, nullptr);
+
+		m_stagingPool.destroy();
+
 		vmaDestroyAllocator(m_allocator);
 		m_initialized = false;
 	}
@@ -3,17 +3,33 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <unordered_map>
+#include <vector>
 
 #include <vulkan/vulkan_core.h>
 
+#include "io/image.h"
+
 #include "types/allocated.h"
+#include "types/anti_aliasing.h"
 #include "types/pipeline.h"
+#include "types/present_mode.h"
+#include "types/texture.h"
+#include "types/texture_filter.h"
 
+#include "frame_pacer.h"
+#include "page_cache.h"
+#include "resolution_scaler.h"
+#include "staging_pool.h"
 #include "vulkan_context.h"
 
-const uint32_t FRAMES_IN_FLIGHT = 2;
-
-class Image;
+const uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+// descriptor sets for textures, the least recently drawn are evicted to stay under it
+const uint32_t MAX_TEXTURES = 256;
+const uint32_t MAX_UPLOAD_BATCHES = 4;
+// pages copied into the cache of a tiled texture per frame, the rest follow in the next ones
+const uint32_t MAX_PAGE_UPLOADS = 16;
+const size_t DEFAULT_STAGING_MEMORY_CAP = 64 * 1024 * 1024;
 
 typedef struct VmaAllocator_T *VmaAllocator;
 typedef struct VmaAllocationInfo VmaAllocationInfo;
@@ -27,66 +43,293 @@ typedef struct {
 	float modelMatrix[16];
 } ObjectConstants;
 
+typedef struct {
+	float modelMatrix[16];
+	float imageSize[2];
+} TiledObjectConstants;
+
+typedef struct {
+	float sourceSize[2];
+	float targetSize[2];
+} PostConstants;
+
+typedef struct {
+	VkBuffer srcBuffer;
+	VkDeviceSize srcOffset;
+	VkBuffer dstBuffer;
+	VkDeviceSize size;
+} BufferUpload;
+
+typedef struct {
+	VkBuffer srcBuffer;
+	VkDeviceSize srcOffset;
+	VkImage dstImage;
+	ImageFormat format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t mipLevels;
+	// levels in the staging memory, the rest are blitted from the last of them
+	uint32_t copiedLevels;
+} ImageUpload;
+
+typedef struct {
+	VkCommandBuffer commandBuffer;
+	VkFence fence;
+	uint64_t serial;
+	// ownership released by the transfer queue, acquired by the first frame after the fence signals
+	std::vector<VkBufferMemoryBarrier> bufferBarriers;
+	std::vector<VkImageMemoryBarrier> imageBarriers;
+	// a transfer queue cannot blit, their mip chains are generated after the acquire
+	std::vector<ImageUpload> mipmapUploads;
+} UploadBatch;
+
+typedef struct {
+	Texture texture;
+	// superseded while its batch was in flight, destroyed once that batch completes
+	uint64_t serial;
+} DiscardedTexture;
+
+typedef struct {
+	Texture texture;
+	// frame count when it was replaced, the frames before may still sample it
+	uint64_t frame;
+} RetiredTexture;
+
+typedef struct {
+	// kept in system memory, so an evicted texture can be uploaded again when it is drawn
+	Image image;
+	TextureFilter filter;
+	Texture texture;
+	bool resident;
+	// batch the copy went out with, the texture can be sampled once a frame acquired it
+	uint64_t serial;
+	// frame count when it was last drawn
+	uint64_t lastUsedFrame;
+	// too large to be a texture of its own, drawn from the pages around the view
+	bool tiled;
+	PageCache pages;
+	// the cache and its page table have a layout to transition from
+	bool pagesWritten;
+	// reloaded at the same size, a frame copies the new image over the texture it draws
+	bool refreshing;
+	// reloaded at another size, replaces the texture once a frame acquired its upload
+	bool replacing;
+	Texture replacement;
+	uint64_t replacementSerial;
+} TextureEntry;
+
 class RenderingDevice {
 private:
 	VulkanContext m_context;
 	bool m_initialized = false;
 
 	uint32_t m_frame = 0;
+	uint32_t m_framesInFlight = 2;
 	uint32_t m_width, m_height;
 	bool m_resized = false;
 
 	VmaAllocator m_allocator;
 
-	VkCommandBuffer m_commandBuffers[FRAMES_IN_FLIGHT];
-	VkSemaphore m_presentSemaphores[FRAMES_IN_FLIGHT];
-	VkSemaphore m_renderSemaphores[FRAMES_IN_FLIGHT];
-	VkFence m_renderFences[FRAMES_IN_FLIGHT];
+	// the scene is submitted before acquire, only the output pass waits for a swapchain image
+	VkCommandBuffer m_sceneCommandBuffers[MAX_FRAMES_IN_FLIGHT];
+	VkCommandBuffer m_outputCommandBuffers[MAX_FRAMES_IN_FLIGHT];
+	VkSemaphore m_presentSemaphores[MAX_FRAMES_IN_FLIGHT];
+	VkSemaphore m_renderSemaphores[MAX_FRAMES_IN_FLIGHT];
+	VkFence m_renderFences[MAX_FRAMES_IN_FLIGHT];
 
 	VkDescriptorPool m_descriptorPool;
 	VkDescriptorSetLayout m_uniformSetLayout;
-	VkDescriptorSet m_uniformSets[FRAMES_IN_FLIGHT];
+	VkDescriptorSet m_uniformSets[MAX_FRAMES_IN_FLIGHT];
 
-	AllocatedBuffer m_uniformBuffers[FRAMES_IN_FLIGHT];
+	AllocatedBuffer m_uniformBuffers[MAX_FRAMES_IN_FLIGHT];
 	VmaAllocationInfo *m_uniformBufferAllocInfos;
 
-	AllocatedImage m_image;
-	bool m_imageValid = false;
-	uint32_t m_imageWidth, m_imageHeight;
-	VkImageView m_imageView;
 	VkSampler m_sampler;
+	VkSampler m_linearSampler;
+	VkSampler m_trilinearSampler;
 
+	VkDescriptorPool m_textureDescriptorPool;
 	VkDescriptorSetLayout m_textureSetLayout;
-	VkDescriptorSet m_textureSet;
+	VkDescriptorSetLayout m_tiledTextureSetLayout;
+
+	// pages and page table entries are copied by the frame that draws them, one buffer per frame in flight
+	AllocatedBuffer m_pageStagingBuffers[MAX_FRAMES_IN_FLIGHT];
+	void *m_pageStagingData[MAX_FRAMES_IN_FLIGHT];
+	bool m_pageStagingCreated = false;
+	std::vector<uint32_t> m_missingPages;
+	// visible pages were left for later frames
+	bool m_pagesPending = false;
+
+	// by the id the server handed out, GPU copies come and go with the memory budget
+	std::unordered_map<uint32_t, TextureEntry> m_textures;
+	// the requested texture streams in on the transfer queue while the shown one keeps drawing
+	uint32_t m_spriteTexture = 0;
+	uint32_t m_shownTexture = 0;
+
+	// device memory and descriptor sets held by textures, released ones included until they are destroyed
+	VkDeviceSize m_textureMemory = 0;
+	uint32_t m_textureCount = 0;
+	// 0 leaves the limit to the device budget
+	VkDeviceSize m_textureMemoryCap = 0;
+
+	std::vector<DiscardedTexture> m_discardedTextures;
+	// refreshing or replacing, in the order they were reloaded
+	std::vector<uint32_t> m_reloadedTextures;
+
+	// copies requested since the last frame, recorded into a single batch when the next one starts
+	std::vector<BufferUpload> m_bufferUploads;
+	std::vector<ImageUpload> m_imageUploads;
+
+	// submitted on the transfer queue, oldest first
+	UploadBatch m_uploadBatches[MAX_UPLOAD_BATCHES];
+	uint32_t m_uploadBatchFirst = 0;
+	uint32_t m_uploadBatchCount = 0;
+	// serials of the last batch submitted and of the last one acquired by a frame
+	uint64_t m_uploadSerial = 0;
+	uint64_t m_completedUploadSerial = 0;
+
+	StagingPool m_stagingPool;
+	size_t m_stagingMemoryCap = DEFAULT_STAGING_MEMORY_CAP;
+
+	std::vector<RetiredTexture> m_retiredTextures;
+	// scenes submitted so far
+	uint64_t m_frameCount = 0;
+
+	// the scene is drawn at the internal resolution, then upscaled into the swapchain
+	VkRenderPass m_sceneRenderPass;
+	AllocatedImage m_sceneImage;
+	VkImageView m_sceneImageView;
+	AllocatedImage m_sceneMultisampleImage;
+	VkImageView m_sceneMultisampleImageView;
+	VkFramebuffer m_sceneFramebuffer;
+	VkExtent2D m_sceneExtent;
+	VkDescriptorSet m_sceneTextureSet;
+
+	ResolutionScaler m_resolutionScaler;
+
+	// pixel art mode renders at a fixed virtual resolution and scales it up by whole multiples
+	uint32_t m_virtualWidth = 0;
+	uint32_t m_virtualHeight = 0;
+
+	AntiAliasing m_antiAliasing = ANTI_ALIASING_OFF;
+	VkSampleCountFlagBits m_sampleCount = VK_SAMPLE_COUNT_1_BIT;
+
+	FramePacer m_framePacer;
+	uint64_t m_presentId = 0;
+	// presented, but not yet measured by the frame pacer
+	bool m_framePending = false;
+
+	float m_cameraX = 0.0f;
+	float m_cameraY = 0.0f;
+
+	float m_spriteX = 0.0f;
+	float m_spriteY = 0.0f;
+	float m_spriteRotation = 0.0f;
+
+	VkQueryPool m_timestampPool = VK_NULL_HANDLE;
+	bool m_timestampsWritten[MAX_FRAMES_IN_FLIGHT] = {};
+	float m_timestampPeriod = 0.0f;
 
 	Pipeline m_checkerboardPipeline;
 	Pipeline m_spritePipeline;
-
-	VkCommandBuffer _beginSingleTimeCommands();
-	void _endSingleTimeCommands(VkCommandBuffer commandBuffer);
+	Pipeline m_tiledSpritePipeline;
+	Pipeline m_upscalePipeline;
+	Pipeline m_fxaaPipeline;
+	Pipeline m_nearestPipeline;
 
 	AllocatedBuffer _bufferCreate(size_t size, VkBufferUsageFlags usage, VmaAllocationInfo *allocInfo);
-	void _bufferCopy(VkBuffer srcBuffer, VkBuffer dstBuffer, size_t size);
 	void _bufferUpdate(VkBuffer buffer, void *data, size_t size);
 	void _bufferDestroy(AllocatedBuffer buffer);
 
-	AllocatedImage _imageCreate(uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage);
-	void _imageUpdate(VkImage image, uint32_t width, uint32_t height, VkFormat format, void *data, size_t size);
+	AllocatedImage _imageCreate(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format,
+			VkImageUsageFlags usage, VkSampleCountFlagBits samples);
+	// expects every level in TRANSFER_DST with the copied ones written, leaves them all shader readable
+	void _mipmapsRecord(VkCommandBuffer commandBuffer, const ImageUpload &upload);
+	// the levels in the staging memory, every level in TRANSFER_DST
+	void _imageCopyRecord(VkCommandBuffer commandBuffer, const ImageUpload &upload);
 	void _imageDestroy(AllocatedImage image);
 
-	VkImageView _imageViewCreate(VkImage image, VkFormat format);
+	VkImageView _imageViewCreate(VkImage image, uint32_t mipLevels, VkFormat format);
 	void _imageViewDestroy(VkImageView imageView);
 
+	Texture _textureCreate(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, TextureFilter filter);
+	// the page cache of an image drawn in pages, sized for the cache rather than the image
+	Texture _tiledTextureCreate(const Image &image, TextureFilter filter, const PageCache &pages);
+	void _textureDestroy(const Texture &texture);
+	void _textureRetire(const Texture &texture);
+	void _retiredTexturesCollect();
+
+	bool _stagingAllocate(VkDeviceSize size, StagingAllocation *allocation);
+	bool _textureUpload(const Image &image, TextureFilter filter, Texture *texture);
+	void _textureDiscard(const Texture &texture, uint64_t serial);
+
+	bool _isTiled(const Image &image) const;
+	bool _textureMakeResident(TextureEntry &entry);
+	void _textureRelease(TextureEntry &entry);
+	// bytes of texture memory over the cap or the device budget, whichever is further
+	VkDeviceSize _textureMemoryExcess();
+	void _texturesEvict(bool needsDescriptor);
+	void _texturesUpdate();
+	// copies the missing pages around the view of viewExtent pixels into the cache
+	void _pagesStream(VkCommandBuffer commandBuffer, TextureEntry &entry, VkExtent2D viewExtent);
+	bool _textureRefreshRecord(VkCommandBuffer commandBuffer, TextureEntry &entry);
+	// true when refreshes were recorded, their staging memory is retired once the frame is submitted
+	bool _reloadsUpdate(VkCommandBuffer commandBuffer);
+
+	void _uploadRecord(UploadBatch &batch);
+	void _uploadFlush();
+	void _uploadPoll(VkCommandBuffer commandBuffer);
+
+	VkSampleCountFlagBits _sampleCount(AntiAliasing antiAliasing) const;
+
+	void _sceneRenderPassCreate();
+	void _sceneTargetCreate();
+	void _sceneTargetDestroy();
+	void _scenePipelinesCreate();
+	void _scenePipelinesDestroy();
+	void _swapchainResize();
+
+	bool _isPixelArt() const;
+	VkExtent2D _renderExtent() const;
+	VkViewport _outputViewport() const;
+	float _gpuFrameTime(uint32_t frame);
+
 public:
 	VkInstance instance();
 
-	void draw();
+	// blocks until the frame pacer wants the next frame started, read input after it returns
+	void frameWait();
+	// returns false when no frame could be drawn, e.g. while the window is minimized
+	bool draw();
 
-	void spriteCreate(Image *image);
+	// nothing is uploaded until the texture is drawn
+	void textureCreate(uint32_t texture, Image &&image, TextureFilter filter);
+	void textureDestroy(uint32_t texture);
+	// frames keep drawing the old pixels until the new ones are on the GPU
+	void textureUpdate(uint32_t texture, Image &&image);
+	// the old sprite stays on screen until the new texture finished uploading, 0 hides it
+	void spriteTextureSet(uint32_t texture);
+	bool isUploadPending() const;
 
 	void windowCreate(VkSurfaceKHR surface, uint32_t width, uint32_t height);
 	void windowResize(uint32_t width, uint32_t height);
 
+	void renderScaleSet(float scale);
+	void dynamicResolutionSet(bool enabled, float targetFrameTime);
+	void antiAliasingSet(AntiAliasing antiAliasing);
+	void virtualResolutionSet(uint32_t width, uint32_t height);
+	void presentModeSet(PresentMode presentMode);
+	void swapchainImageCountSet(uint32_t imageCount);
+	void framesInFlightSet(uint32_t framesInFlight);
+	void framePacingSet(bool enabled);
+	void refreshRateSet(float refreshRate);
+
+	void stagingMemoryCapSet(size_t size);
+	void textureMemoryCapSet(size_t size);
+
+	void cameraSet(float x, float y);
+	void spriteTransformSet(float x, float y, float rotation);
+
 	void create(const char *const *extensions, uint32_t extensionCount, bool validation);
 	void destroy();
 };
@@ -1,36 +1,488 @@
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <thread>
+#include <utility>
+
+#include "core/hash.h"
 
 #include "rendering_device.h"
 #include "rendering_server.h"
 
+const float DEFAULT_FRAME_TIME = 1000.0f / 60.0f;
+
+// frames game logic may queue ahead of the render thread
+const uint32_t MAX_QUEUED_FRAMES = 1;
+
+template <typename F>
+void RS::_call(const F &function) {
+	if (!m_threaded) {
+		function();
+		return;
+	}
+
+	// the ring is full, the render thread is behind
+	while (!m_commands.push(function))
+		std::this_thread::yield();
+
+	// pairs with the fence in _renderThreadLoop, either it sees the command or we see it idle
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	if (m_renderThreadIdle) {
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_wakeCondition.notify_one();
+	}
+}
+
+void RS::_renderThreadLoop() {
+	while (true) {
+		if (m_commands.pop())
+			continue;
+
+		if (!m_running)
+			break;
+
+		m_renderThreadIdle = true;
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		{
+			std::unique_lock<std::mutex> lock(m_wakeMutex);
+			m_wakeCondition.wait(lock, [this]() { return !m_commands.isEmpty() || !m_running; });
+		}
+
+		m_renderThreadIdle = false;
+	}
+}
+
 void RS::initialize(int argc, char **argv, const char **extensions, uint32_t extensionCount) {
 	bool validation = false;
+	bool dynamicResolution = false;
+	AntiAliasing antiAliasing = ANTI_ALIASING_OFF;
+	uint32_t virtualWidth = 0;
+	uint32_t virtualHeight = 0;
+	PresentMode presentMode = PRESENT_MODE_MAILBOX;
+	uint32_t swapchainImageCount = 0;
+	uint32_t framesInFlight = 2;
+	bool framePacing = false;
+	bool renderThread = false;
+	uint32_t stagingMemory = 0;
+	uint32_t textureMemory = 0;
+
 	for (int i = 0; i < argc; i++) {
 		if (strcmp("--validate", argv[i]) == 0)
 			validation = true;
+
+		if (strcmp("--dynamic-resolution", argv[i]) == 0)
+			dynamicResolution = true;
+
+		if (strcmp("--fxaa", argv[i]) == 0)
+			antiAliasing = ANTI_ALIASING_FXAA;
+
+		if (strcmp("--msaa", argv[i]) == 0 && i + 1 < argc) {
+			int samples = atoi(argv[i + 1]);
+
+			if (samples >= 8) {
+				antiAliasing = ANTI_ALIASING_MSAA_8X;
+			} else if (samples >= 4) {
+				antiAliasing = ANTI_ALIASING_MSAA_4X;
+			} else if (samples >= 2) {
+				antiAliasing = ANTI_ALIASING_MSAA_2X;
+			}
+		}
+
+		if (strcmp("--virtual-resolution", argv[i]) == 0 && i + 1 < argc) {
+			if (sscanf(argv[i + 1], "%ux%u", &virtualWidth, &virtualHeight) != 2) {
+				printf("Invalid virtual resolution, expected WIDTHxHEIGHT!\n");
+				virtualWidth = 0;
+				virtualHeight = 0;
+			}
+		}
+
+		if (strcmp("--present-mode", argv[i]) == 0 && i + 1 < argc) {
+			if (strcmp("fifo", argv[i + 1]) == 0) {
+				presentMode = PRESENT_MODE_FIFO;
+			} else if (strcmp("fifo-relaxed", argv[i + 1]) == 0) {
+				presentMode = PRESENT_MODE_FIFO_RELAXED;
+			} else if (strcmp("mailbox", argv[i + 1]) == 0) {
+				presentMode = PRESENT_MODE_MAILBOX;
+			} else if (strcmp("immediate", argv[i + 1]) == 0) {
+				presentMode = PRESENT_MODE_IMMEDIATE;
+			} else {
+				printf("Invalid present mode, expected fifo, fifo-relaxed, mailbox or immediate!\n");
+			}
+		}
+
+		if (strcmp("--swapchain-images", argv[i]) == 0 && i + 1 < argc)
+			swapchainImageCount = (uint32_t)atoi(argv[i + 1]);
+
+		if (strcmp("--frames-in-flight", argv[i]) == 0 && i + 1 < argc)
+			framesInFlight = (uint32_t)atoi(argv[i + 1]);
+
+		if (strcmp("--frame-pacing", argv[i]) == 0)
+			framePacing = true;
+
+		if (strcmp("--render-thread", argv[i]) == 0)
+			renderThread = true;
+
+		if (strcmp("--staging-memory", argv[i]) == 0 && i + 1 < argc)
+			stagingMemory = (uint32_t)atoi(argv[i + 1]);
+
+		if (strcmp("--texture-memory", argv[i]) == 0 && i + 1 < argc)
+			textureMemory = (uint32_t)atoi(argv[i + 1]);
 	}
 
 	m_renderingDevice = new RenderingDevice;
 	m_renderingDevice->create(extensions, extensionCount, validation);
+
+	if (dynamicResolution)
+		m_renderingDevice->dynamicResolutionSet(true, DEFAULT_FRAME_TIME);
+
+	m_renderingDevice->antiAliasingSet(antiAliasing);
+	m_renderingDevice->virtualResolutionSet(virtualWidth, virtualHeight);
+	m_renderingDevice->presentModeSet(presentMode);
+	m_renderingDevice->swapchainImageCountSet(swapchainImageCount);
+	m_renderingDevice->framesInFlightSet(framesInFlight);
+	m_renderingDevice->framePacingSet(framePacing);
+	m_framePacing = framePacing;
+
+	if (stagingMemory > 0)
+		m_renderingDevice->stagingMemoryCapSet((size_t)stagingMemory * 1024 * 1024);
+
+	if (textureMemory > 0)
+		m_renderingDevice->textureMemoryCapSet((size_t)textureMemory * 1024 * 1024);
+
+	if (renderThread) {
+		m_running = true;
+		m_threaded = true;
+		m_renderThread = std::thread(&RS::_renderThreadLoop, this);
+	}
 }
 
 VkInstance RS::vulkanInstance() {
+	sync();
 	return m_renderingDevice->instance();
 }
 
-void RS::spriteCreate(Image *image) {
-	m_renderingDevice->spriteCreate(image);
+// identical pixels only share a texture when they are laid out and sampled the same way too
+static uint64_t textureContentKey(const Image &image, TextureFilter filter, uint64_t pixelHash) {
+	if (pixelHash == 0)
+		return 0;
+
+	uint32_t layout[] = { image.width(), image.height(), image.mipLevels(), (uint32_t)image.format(),
+		(uint32_t)image.colorSpace(), (uint32_t)filter };
+
+	return hash64(layout, sizeof(layout), pixelHash);
+}
+
+uint32_t RS::_deviceTextureCreate(Image &&image, TextureFilter filter, uint64_t contentKey) {
+	if (contentKey != 0) {
+		std::unordered_map<uint64_t, uint32_t>::iterator found = m_contentTextures.find(contentKey);
+
+		// the device already has these pixels, the image is dropped here
+		if (found != m_contentTextures.end()) {
+			m_deviceTextures[found->second].references += 1;
+			return found->second;
+		}
+	}
+
+	m_deviceTextureCount += 1;
+	uint32_t deviceTexture = m_deviceTextureCount;
+
+	SharedTexture shared = {
+		.filter = filter,
+		.contentKey = contentKey,
+		.references = 1,
+	};
+
+	m_deviceTextures[deviceTexture] = shared;
+
+	if (contentKey != 0)
+		m_contentTextures[contentKey] = deviceTexture;
+
+	// commands are copied into the ring, so the image rides along on the heap until the device owns it
+	Image *pending = new Image(std::move(image));
+
+	_call([=]() {
+		m_renderingDevice->textureCreate(deviceTexture, std::move(*pending), filter);
+		delete pending;
+	});
+
+	return deviceTexture;
+}
+
+void RS::_deviceTextureRelease(uint32_t deviceTexture) {
+	std::unordered_map<uint32_t, SharedTexture>::iterator shared = m_deviceTextures.find(deviceTexture);
+
+	shared->second.references -= 1;
+	if (shared->second.references > 0)
+		return;
+
+	if (shared->second.contentKey != 0)
+		m_contentTextures.erase(shared->second.contentKey);
+
+	m_deviceTextures.erase(shared);
+	_call([=]() { m_renderingDevice->textureDestroy(deviceTexture); });
+}
+
+uint32_t RS::textureCreate(Image &&image, TextureFilter filter, uint64_t pixelHash) {
+	m_textureCount += 1;
+	uint32_t texture = m_textureCount;
+
+	uint64_t key = textureContentKey(image, filter, pixelHash);
+	m_textureIds[texture] = _deviceTextureCreate(std::move(image), filter, key);
+
+	return texture;
+}
+
+void RS::textureDestroy(uint32_t texture) {
+	std::unordered_map<uint32_t, uint32_t>::iterator id = m_textureIds.find(texture);
+	if (id == m_textureIds.end())
+		return;
+
+	// other ids may keep the texture alive, the sprite is hidden all the same
+	if (m_spriteTexture == texture)
+		spriteTextureSet(0);
+
+	_deviceTextureRelease(id->second);
+	m_textureIds.erase(id);
+	m_redrawPending = true;
+}
+
+void RS::textureUpdate(uint32_t texture, Image &&image, uint64_t pixelHash) {
+	std::unordered_map<uint32_t, uint32_t>::iterator id = m_textureIds.find(texture);
+	if (id == m_textureIds.end())
+		return;
+
+	uint32_t deviceTexture = id->second;
+	SharedTexture &shared = m_deviceTextures[deviceTexture];
+	TextureFilter filter = shared.filter;
+	uint64_t key = textureContentKey(image, filter, pixelHash);
+
+	if (shared.references == 1) {
+		// the only id standing for it, reloaded in place; the new pixels are only shared when nothing has them yet
+		if (shared.contentKey != 0)
+			m_contentTextures.erase(shared.contentKey);
+
+		shared.contentKey = key != 0 && m_contentTextures.count(key) == 0 ? key : 0;
+
+		if (shared.contentKey != 0)
+			m_contentTextures[shared.contentKey] = deviceTexture;
+
+		Image *pending = new Image(std::move(image));
+
+		_call([=]() {
+			m_renderingDevice->textureUpdate(deviceTexture, std::move(*pending));
+			delete pending;
+		});
+
+		m_redrawPending = true;
+		return;
+	}
+
+	// the other ids keep the old pixels, this one moves to a texture of its own or one that has the new pixels
+	_deviceTextureRelease(deviceTexture);
+	id->second = _deviceTextureCreate(std::move(image), filter, key);
+
+	// shown until the new texture finished uploading, like any other sprite change
+	if (m_spriteTexture == texture)
+		spriteTextureSet(texture);
+
+	m_redrawPending = true;
+}
+
+void RS::spriteTextureSet(uint32_t texture) {
+	uint32_t deviceTexture = 0;
+
+	if (texture != 0) {
+		std::unordered_map<uint32_t, uint32_t>::iterator id = m_textureIds.find(texture);
+		if (id == m_textureIds.end())
+			return;
+
+		deviceTexture = id->second;
+	}
+
+	m_spriteTexture = texture;
+	_call([=]() { m_renderingDevice->spriteTextureSet(deviceTexture); });
+	m_redrawPending = true;
 }
 
 void RS::windowCreate(VkSurfaceKHR surface, uint32_t width, uint32_t height) {
-	m_renderingDevice->windowCreate(surface, width, height);
+	_call([=]() { m_renderingDevice->windowCreate(surface, width, height); });
 }
 
 void RS::windowResize(uint32_t width, uint32_t height) {
-	m_renderingDevice->windowResize(width, height);
+	_call([=]() { m_renderingDevice->windowResize(width, height); });
+	m_redrawPending = true;
+}
+
+void RS::renderScaleSet(float scale) {
+	_call([=]() { m_renderingDevice->renderScaleSet(scale); });
+	m_redrawPending = true;
+}
+
+void RS::dynamicResolutionSet(bool enabled, float targetFrameTime) {
+	_call([=]() { m_renderingDevice->dynamicResolutionSet(enabled, targetFrameTime); });
+	m_redrawPending = true;
+}
+
+void RS::antiAliasingSet(AntiAliasing antiAliasing) {
+	_call([=]() { m_renderingDevice->antiAliasingSet(antiAliasing); });
+	m_redrawPending = true;
+}
+
+void RS::virtualResolutionSet(uint32_t width, uint32_t height) {
+	_call([=]() { m_renderingDevice->virtualResolutionSet(width, height); });
+	m_redrawPending = true;
+}
+
+void RS::presentModeSet(PresentMode presentMode) {
+	_call([=]() { m_renderingDevice->presentModeSet(presentMode); });
+	m_redrawPending = true;
+}
+
+void RS::swapchainImageCountSet(uint32_t imageCount) {
+	_call([=]() { m_renderingDevice->swapchainImageCountSet(imageCount); });
+	m_redrawPending = true;
+}
+
+void RS::framesInFlightSet(uint32_t framesInFlight) {
+	_call([=]() { m_renderingDevice->framesInFlightSet(framesInFlight); });
+}
+
+void RS::framePacingSet(bool enabled) {
+	m_framePacing = enabled;
+	_call([=]() { m_renderingDevice->framePacingSet(enabled); });
+}
+
+void RS::refreshRateSet(float refreshRate) {
+	_call([=]() { m_renderingDevice->refreshRateSet(refreshRate); });
+}
+
+void RS::stagingMemorySet(uint32_t megabytes) {
+	_call([=]() { m_renderingDevice->stagingMemoryCapSet((size_t)megabytes * 1024 * 1024); });
+}
+
+void RS::textureMemorySet(uint32_t megabytes) {
+	_call([=]() { m_renderingDevice->textureMemoryCapSet((size_t)megabytes * 1024 * 1024); });
+}
+
+void RS::cameraSet(float x, float y) {
+	_call([=]() { m_renderingDevice->cameraSet(x, y); });
+	m_redrawPending = true;
+}
+
+void RS::snapshotPublish(const SceneSnapshot &snapshot) {
+	m_snapshots.publish(snapshot);
 }
 
-void RS::draw() {
-	m_renderingDevice->draw();
+void RS::snapshotInterpolate(float fraction) {
+	if (m_snapshots.update()) {
+		m_previousSnapshot = m_currentSnapshot;
+		m_currentSnapshot = m_snapshots.latest();
+	}
+
+	SceneSnapshot snapshot;
+	snapshot.sprite = transformInterpolate(m_previousSnapshot.sprite, m_currentSnapshot.sprite, fraction);
+
+	// a resting simulation must not keep the renderer busy
+	if (memcmp(&snapshot, &m_drawnSnapshot, sizeof(snapshot)) == 0)
+		return;
+
+	const Transform &sprite = snapshot.sprite;
+	_call([=]() { m_renderingDevice->spriteTransformSet(sprite.x, sprite.y, sprite.rotation); });
+
+	m_drawnSnapshot = snapshot;
+	m_redrawPending = true;
+}
+
+void RS::redrawRequest() {
+	m_redrawPending = true;
+}
+
+bool RS::isRedrawPending() const {
+	return m_redrawPending;
+}
+
+void RS::frameWait() {
+	if (!m_framePacing)
+		return;
+
+	// the pacer waits on the frames the render thread submitted, let it catch up first
+	_call([=]() { m_renderingDevice->frameWait(); });
+	sync();
+}
+
+bool RS::draw() {
+	if (!m_redrawPending)
+		return false;
+
+	if (!m_threaded) {
+		if (!m_renderingDevice->draw())
+			return false;
+
+		// keep drawing until a streaming texture shows up
+		m_redrawPending = m_renderingDevice->isUploadPending();
+		return true;
+	}
+
+	// the last queued frame could not be drawn, e.g. while minimized
+	if (m_drawFailed.exchange(false))
+		return false;
+
+	{
+		std::unique_lock<std::mutex> lock(m_frameMutex);
+		m_frameCondition.wait(lock, [this]() { return m_queuedFrames < MAX_QUEUED_FRAMES; });
+		m_queuedFrames++;
+	}
+
+	m_redrawPending = false;
+
+	_call([=]() {
+		if (!m_renderingDevice->draw()) {
+			m_drawFailed = true;
+			m_redrawPending = true;
+		} else if (m_renderingDevice->isUploadPending()) {
+			m_redrawPending = true;
+		}
+
+		std::lock_guard<std::mutex> lock(m_frameMutex);
+		m_queuedFrames--;
+		m_frameCondition.notify_one();
+	});
+
+	return true;
+}
+
+void RS::sync() {
+	if (!m_threaded)
+		return;
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool done = false;
+
+	_call([&]() {
+		std::lock_guard<std::mutex> lock(mutex);
+		done = true;
+		condition.notify_one();
+	});
+
+	std::unique_lock<std::mutex> lock(mutex);
+	condition.wait(lock, [&]() { return done; });
+}
+
+void RS::finalize() {
+	if (!m_threaded)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_running = false;
+	}
+
+	m_wakeCondition.notify_one();
+	m_renderThread.join();
+
+	m_threaded = false;
 }
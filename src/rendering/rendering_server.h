@@ -1,7 +1,20 @@
 #ifndef RENDERING_SERVER_H
 #define RENDERING_SERVER_H
 
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "core/command_ring.h"
+#include "core/snapshot_buffer.h"
+
+#include "types/anti_aliasing.h"
+#include "types/present_mode.h"
+#include "types/scene_snapshot.h"
+#include "types/texture_filter.h"
 
 class Image;
 class RenderingDevice;
@@ -9,6 +22,8 @@ class RenderingDevice;
 typedef struct VkInstance_T *VkInstance;
 typedef struct VkSurfaceKHR_T *VkSurfaceKHR;
 
+const uint32_t COMMAND_RING_CAPACITY = 256;
+
 class RenderingServer {
 public:
 	static RenderingServer &singleton() {
@@ -22,19 +37,124 @@ public:
 private:
 	RenderingDevice *m_renderingDevice;
 
+	// set by anything that changes what the next frame looks like
+	std::atomic<bool> m_redrawPending{ true };
+	bool m_framePacing = false;
+
+	// with a render thread, device calls are queued and run there in order
+	bool m_threaded = false;
+	std::atomic<bool> m_running{ false };
+	std::thread m_renderThread;
+	CommandRing<COMMAND_RING_CAPACITY> m_commands;
+
+	// the render thread sleeps once it runs out of commands, pushing wakes it up
+	std::atomic<bool> m_renderThreadIdle{ false };
+	std::mutex m_wakeMutex;
+	std::condition_variable m_wakeCondition;
+
+	// queued frames not yet drawn, bounds how far game logic runs ahead
+	uint32_t m_queuedFrames = 0;
+	std::mutex m_frameMutex;
+	std::condition_variable m_frameCondition;
+	// a queued frame could not be drawn, reported by the next draw()
+	std::atomic<bool> m_drawFailed{ false };
+
+	typedef struct {
+		TextureFilter filter;
+		// identifies the pixels and how they are sampled, 0 for textures never shared
+		uint64_t contentKey;
+		// ids standing for the texture, it is destroyed on the device once none is left
+		uint32_t references;
+	} SharedTexture;
+
+	// handed out on the calling thread, so an id is known before the device creates its texture
+	uint32_t m_textureCount = 0;
+	uint32_t m_deviceTextureCount = 0;
+	// ids created from identical images stand for one device texture
+	std::unordered_map<uint32_t, uint32_t> m_textureIds;
+	std::unordered_map<uint32_t, SharedTexture> m_deviceTextures;
+	std::unordered_map<uint64_t, uint32_t> m_contentTextures;
+	// the id last set, so it can follow when a reload gives it a texture of its own
+	uint32_t m_spriteTexture = 0;
+
+	SnapshotBuffer<SceneSnapshot> m_snapshots;
+	// the renderer draws in between the last two snapshots it took
+	SceneSnapshot m_previousSnapshot = {};
+	SceneSnapshot m_currentSnapshot = {};
+	SceneSnapshot m_drawnSnapshot = {};
+
 	RenderingServer() {}
 
+	// runs on the render thread when there is one, right away otherwise
+	template <typename F>
+	void _call(const F &function);
+	void _renderThreadLoop();
+
+	uint32_t _deviceTextureCreate(Image &&image, TextureFilter filter, uint64_t contentKey);
+	void _deviceTextureRelease(uint32_t deviceTexture);
+
 public:
 	void initialize(int argc, char **argv, const char **extensions, uint32_t extensionCount);
 
 	VkInstance vulkanInstance();
 
-	void spriteCreate(Image *image);
+	// nearest keeps pixel art sharp, trilinear reads the smaller mip levels when scaled down; the image stays in
+	// system memory and is uploaded when first drawn, ids start at 1. Images with the same pixel hash, size and
+	// filter share one texture, a hash of 0 never does
+	uint32_t textureCreate(Image &&image, TextureFilter filter, uint64_t pixelHash = 0);
+	void textureDestroy(uint32_t texture);
+	// new pixels for an existing texture, e.g. after the file changed on disk; a shared texture keeps the old ones
+	// for the other ids
+	void textureUpdate(uint32_t texture, Image &&image, uint64_t pixelHash = 0);
+	// the old sprite stays on screen until the new texture finished uploading, 0 hides it
+	void spriteTextureSet(uint32_t texture);
 
 	void windowCreate(VkSurfaceKHR surface, uint32_t width, uint32_t height);
 	void windowResize(uint32_t width, uint32_t height);
 
-	void draw();
+	// fixed internal resolution as a fraction of the window, disables dynamic resolution
+	void renderScaleSet(float scale);
+	// lets the internal resolution follow GPU frame time, targetFrameTime is in milliseconds
+	void dynamicResolutionSet(bool enabled, float targetFrameTime);
+	// MSAA counts the device cannot render fall back to the highest supported one
+	void antiAliasingSet(AntiAliasing antiAliasing);
+	// renders into a fixed low resolution target shown at whole multiples, 0x0 turns it off
+	void virtualResolutionSet(uint32_t width, uint32_t height);
+	// IMMEDIATE is uncapped for benchmarking, unsupported modes fall back to FIFO
+	void presentModeSet(PresentMode presentMode);
+	// fewer images lower the latency of FIFO, 0 restores the default of one above the surface minimum
+	void swapchainImageCountSet(uint32_t imageCount);
+	// frames the CPU may record ahead of the GPU, 1 to 4, fewer trade throughput for latency
+	void framesInFlightSet(uint32_t framesInFlight);
+	// starts frames as late as the display allows, meant for FIFO
+	void framePacingSet(bool enabled);
+	void refreshRateSet(float refreshRate);
+	// host memory kept for uploads, uploads wait for earlier ones rather than going over it
+	void stagingMemorySet(uint32_t megabytes);
+	// device memory textures may fill before the least recently drawn are evicted, 0 goes by the device budget
+	void textureMemorySet(uint32_t megabytes);
+
+	void cameraSet(float x, float y);
+
+	// called by the simulation once per step, safe from another thread than the renderer
+	void snapshotPublish(const SceneSnapshot &snapshot);
+	// blends the last two snapshots, fraction is the time since the newest one in steps
+	void snapshotInterpolate(float fraction);
+
+	// asks for a new frame when state the server does not track has changed
+	void redrawRequest();
+	bool isRedrawPending() const;
+
+	// with frame pacing on, sleeps until the next frame should start; poll input after it
+	void frameWait();
+	// skips the frame when it would be identical to the last one, returns whether one was drawn,
+	// or queued with a render thread
+	bool draw();
+
+	// blocks until every call made so far has run on the render thread
+	void sync();
+	// stops the render thread, call before the window goes away
+	void finalize();
 };
 
 typedef RenderingServer RS;
@@ -0,0 +1,94 @@
+#include <cmath>
+#include <cstdint>
+
+#include "resolution_scaler.h"
+
+// weight of the newest sample in the frame time average
+const float SMOOTHING = 0.1f;
+
+// over this fraction of the budget the scale goes down, under the lower one it goes up
+const float UPPER_THRESHOLD = 0.95f;
+const float LOWER_THRESHOLD = 0.80f;
+
+// frames to wait after a change, so the average can catch up before the next one
+const uint32_t COOLDOWN_FRAMES = 15;
+
+const float SCALE_STEP = 1.0f / 32.0f;
+
+static float clamp(float value, float minimum, float maximum) {
+	return value < minimum ? minimum : (value > maximum ? maximum : value);
+}
+
+bool ResolutionScaler::isEnabled() const {
+	return m_enabled;
+}
+
+float ResolutionScaler::targetFrameTime() const {
+	return m_targetFrameTime;
+}
+
+float ResolutionScaler::scale() const {
+	return m_scale;
+}
+
+void ResolutionScaler::enabledSet(bool enabled) {
+	m_enabled = enabled;
+	m_averageFrameTime = 0.0f;
+	m_cooldown = 0;
+}
+
+void ResolutionScaler::targetFrameTimeSet(float milliseconds) {
+	if (milliseconds <= 0.0f)
+		return;
+
+	m_targetFrameTime = milliseconds;
+}
+
+void ResolutionScaler::scaleLimitsSet(float minScale, float maxScale) {
+	m_minScale = clamp(minScale, SCALE_STEP, 1.0f);
+	m_maxScale = clamp(maxScale, m_minScale, 1.0f);
+	m_scale = clamp(m_scale, m_minScale, m_maxScale);
+}
+
+void ResolutionScaler::scaleSet(float scale) {
+	m_scale = clamp(scale, m_minScale, m_maxScale);
+}
+
+void ResolutionScaler::update(float gpuFrameTime) {
+	if (!m_enabled || gpuFrameTime <= 0.0f)
+		return;
+
+	if (m_averageFrameTime == 0.0f) {
+		m_averageFrameTime = gpuFrameTime;
+	} else {
+		m_averageFrameTime += (gpuFrameTime - m_averageFrameTime) * SMOOTHING;
+	}
+
+	if (m_cooldown > 0) {
+		m_cooldown--;
+		return;
+	}
+
+	float load = m_averageFrameTime / m_targetFrameTime;
+	float scale = m_scale;
+
+	if (load > UPPER_THRESHOLD) {
+		// drop straight to the estimated scale, heavy frames should recover fast
+		scale = std::floor(m_scale * std::sqrt(UPPER_THRESHOLD / load) / SCALE_STEP) * SCALE_STEP;
+		if (scale > m_scale - SCALE_STEP)
+			scale = m_scale - SCALE_STEP;
+	} else if (load < LOWER_THRESHOLD) {
+		// climb back slowly to avoid bouncing around the budget
+		scale = m_scale + SCALE_STEP;
+	}
+
+	scale = clamp(scale, m_minScale, m_maxScale);
+
+	if (scale == m_scale)
+		return;
+
+	// the average was measured at the old scale, rescale it to match the new one
+	m_averageFrameTime *= (scale * scale) / (m_scale * m_scale);
+	m_scale = scale;
+	m_cooldown = COOLDOWN_FRAMES;
+}
@@ -0,0 +1,34 @@
+#ifndef RESOLUTION_SCALER_H
+#define RESOLUTION_SCALER_H
+
+#include <cstdint>
+
+// Picks the internal render scale from measured GPU frame times. Cost scales
+// with the pixel count, so the scale moves with the square root of the ratio
+// between the target budget and the measured time.
+class ResolutionScaler {
+private:
+	bool m_enabled = false;
+
+	float m_targetFrameTime = 1000.0f / 60.0f;
+	float m_minScale = 0.5f;
+	float m_maxScale = 1.0f;
+
+	float m_scale = 1.0f;
+	float m_averageFrameTime = 0.0f;
+	uint32_t m_cooldown = 0;
+
+public:
+	bool isEnabled() const;
+	float targetFrameTime() const;
+	float scale() const;
+
+	void enabledSet(bool enabled);
+	void targetFrameTimeSet(float milliseconds);
+	void scaleLimitsSet(float minScale, float maxScale);
+	void scaleSet(float scale);
+
+	void update(float gpuFrameTime);
+};
+
+#endif // !RESOLUTION_SCALER_H
@@ -0,0 +1,63 @@
+#version 450
+
+layout(location = 0) in vec2 texCoord;
+layout(location = 0) out vec4 fragColor;
+
+layout(set = 0, binding = 0) uniform sampler textureSampler;
+layout(set = 0, binding = 1) uniform texture2D textureImage;
+
+layout(push_constant) uniform PostConstants {
+	vec2 SOURCE_SIZE;
+	vec2 TARGET_SIZE;
+};
+
+const float EDGE_THRESHOLD = 1.0 / 8.0;
+const float EDGE_THRESHOLD_MIN = 1.0 / 32.0;
+const float REDUCE_MUL = 1.0 / 8.0;
+const float REDUCE_MIN = 1.0 / 128.0;
+const float SPAN_MAX = 8.0;
+
+float luma(vec3 color) {
+	return dot(color, vec3(0.2126, 0.7152, 0.0722));
+}
+
+// keeps the filter from reading outside of the rendered part of the target
+vec4 fetch(vec2 uv) {
+	vec2 halfTexel = vec2(0.5) / TARGET_SIZE;
+	uv = clamp(uv, halfTexel, SOURCE_SIZE / TARGET_SIZE - halfTexel);
+	return textureLod(sampler2D(textureImage, textureSampler), uv, 0.0);
+}
+
+void main() {
+	vec2 texel = vec2(1.0) / TARGET_SIZE;
+	vec2 uv = texCoord * SOURCE_SIZE / TARGET_SIZE;
+
+	vec4 colorM = fetch(uv);
+
+	float lumaM = luma(colorM.rgb);
+	float lumaNW = luma(fetch(uv + vec2(-1.0, -1.0) * texel).rgb);
+	float lumaNE = luma(fetch(uv + vec2(1.0, -1.0) * texel).rgb);
+	float lumaSW = luma(fetch(uv + vec2(-1.0, 1.0) * texel).rgb);
+	float lumaSE = luma(fetch(uv + vec2(1.0, 1.0) * texel).rgb);
+
+	float lumaMin = min(lumaM, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));
+	float lumaMax = max(lumaM, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));
+
+	if (lumaMax - lumaMin < max(EDGE_THRESHOLD_MIN, lumaMax * EDGE_THRESHOLD)) {
+		fragColor = colorM;
+		return;
+	}
+
+	// blur along the edge, perpendicular to the luma gradient
+	vec2 direction = vec2(-((lumaNW + lumaNE) - (lumaSW + lumaSE)), (lumaNW + lumaSW) - (lumaNE + lumaSE));
+
+	float directionReduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * 0.25 * REDUCE_MUL, REDUCE_MIN);
+	float inverseDirectionMin = 1.0 / (min(abs(direction.x), abs(direction.y)) + directionReduce);
+	direction = clamp(direction * inverseDirectionMin, vec2(-SPAN_MAX), vec2(SPAN_MAX)) * texel;
+
+	vec4 colorA = 0.5 * (fetch(uv + direction * (1.0 / 3.0 - 0.5)) + fetch(uv + direction * (2.0 / 3.0 - 0.5)));
+	vec4 colorB = colorA * 0.5 + 0.25 * (fetch(uv - direction * 0.5) + fetch(uv + direction * 0.5));
+
+	float lumaB = luma(colorB.rgb);
+	fragColor = (lumaB < lumaMin || lumaB > lumaMax) ? colorA : colorB;
+}
@@ -0,0 +1,14 @@
+#version 450
+
+layout(location = 0) out vec2 texCoord;
+
+const vec2 VERTEX[3] = {
+	vec2(-1.0, -1.0),
+	vec2(-1.0, 3.0),
+	vec2(3.0, -1.0)
+};
+
+void main() {
+	texCoord = VERTEX[gl_VertexIndex] * 0.5 + vec2(0.5);
+	gl_Position = vec4(VERTEX[gl_VertexIndex], 0.0, 1.0);
+}
@@ -0,0 +1,19 @@
+#version 450
+
+layout(location = 0) in vec2 texCoord;
+layout(location = 0) out vec4 fragColor;
+
+layout(set = 0, binding = 0) uniform sampler textureSampler;
+layout(set = 0, binding = 1) uniform texture2D textureImage;
+
+layout(push_constant) uniform PostConstants {
+	vec2 SOURCE_SIZE;
+	vec2 TARGET_SIZE;
+};
+
+void main() {
+	// the viewport is an integer multiple of the source, so every texel covers whole pixels
+	ivec2 coords = ivec2(floor(texCoord * SOURCE_SIZE));
+	coords = clamp(coords, ivec2(0), ivec2(SOURCE_SIZE) - ivec2(1));
+	fragColor = texelFetch(sampler2D(textureImage, textureSampler), coords, 0);
+}
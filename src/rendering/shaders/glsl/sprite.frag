@@ -7,6 +7,6 @@ layout(set = 1, binding = 0) uniform sampler textureSampler;
 layout(set = 1, binding = 1) uniform texture2D textureImage;
 
 void main() {
-	vec4 color = texture(sampler2D(textureImage, textureSampler), texCoord);
-	fragColor = pow(color, vec4(2.2));
+	// sRGB textures are decoded by the sampler and hold premultiplied alpha
+	fragColor = texture(sampler2D(textureImage, textureSampler), texCoord);
 }
@@ -0,0 +1,37 @@
+#version 450
+
+layout(location = 0) in vec2 texCoord;
+layout(location = 0) out vec4 fragColor;
+
+layout(set = 1, binding = 0) uniform sampler textureSampler;
+layout(set = 1, binding = 1) uniform texture2D pageCache;
+layout(set = 1, binding = 2) uniform utexture2D pageTable;
+
+layout(push_constant) uniform ObjectConstants {
+	layout(offset = 64) vec2 IMAGE_SIZE;
+};
+
+// matches page_cache.h
+const float PAGE_SIZE = 256.0;
+const float PAGE_BORDER = 1.0;
+const float PAGE_CONTENT = PAGE_SIZE - 2.0 * PAGE_BORDER;
+const float CACHE_SIZE = 4096.0;
+
+const uint PAGE_MISSING = 255u;
+
+void main() {
+	vec2 texel = texCoord * IMAGE_SIZE;
+	ivec2 tableSize = textureSize(usampler2D(pageTable, textureSampler), 0);
+	ivec2 page = min(ivec2(texel / PAGE_CONTENT), tableSize - ivec2(1));
+
+	uvec2 slot = texelFetch(usampler2D(pageTable, textureSampler), page, 0).rg;
+
+	// still streaming in, the checkerboard shows through for a frame or two
+	if (slot.x == PAGE_MISSING)
+		discard;
+
+	vec2 position = vec2(slot) * PAGE_SIZE + PAGE_BORDER + (texel - vec2(page) * PAGE_CONTENT);
+
+	// the cache has a single level, pages are drawn at their own size
+	fragColor = textureLod(sampler2D(pageCache, textureSampler), position / CACHE_SIZE, 0.0);
+}
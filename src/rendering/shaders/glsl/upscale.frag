@@ -0,0 +1,51 @@
+#version 450
+
+layout(location = 0) in vec2 texCoord;
+layout(location = 0) out vec4 fragColor;
+
+layout(set = 0, binding = 0) uniform sampler textureSampler;
+layout(set = 0, binding = 1) uniform texture2D textureImage;
+
+layout(push_constant) uniform PostConstants {
+	vec2 SOURCE_SIZE;
+	vec2 TARGET_SIZE;
+};
+
+// how quickly a luma gradient counts as an edge
+const float EDGE_SHARPNESS = 8.0;
+
+float luma(vec3 color) {
+	return dot(color, vec3(0.2126, 0.7152, 0.0722));
+}
+
+vec4 fetch(ivec2 coords) {
+	coords = clamp(coords, ivec2(0), ivec2(SOURCE_SIZE) - ivec2(1));
+	return texelFetch(sampler2D(textureImage, textureSampler), coords, 0);
+}
+
+void main() {
+	// only the rendered part of the target is valid, so texels are fetched and filtered by hand
+	vec2 position = texCoord * SOURCE_SIZE - vec2(0.5);
+	ivec2 base = ivec2(floor(position));
+	vec2 f = fract(position);
+
+	vec4 a = fetch(base);
+	vec4 b = fetch(base + ivec2(1, 0));
+	vec4 c = fetch(base + ivec2(0, 1));
+	vec4 d = fetch(base + ivec2(1, 1));
+
+	float la = luma(a.rgb);
+	float lb = luma(b.rgb);
+	float lc = luma(c.rgb);
+	float ld = luma(d.rgb);
+
+	vec2 gradient = vec2(lb - la + ld - lc, lc - la + ld - lb) * 0.5;
+	float strength = clamp(length(gradient) * EDGE_SHARPNESS, 0.0, 1.0);
+	vec2 normal = length(gradient) > 1e-5 ? abs(normalize(gradient)) : vec2(0.0);
+
+	// across an edge the transition is steepened, along it the filter stays bilinear
+	vec2 sharp = f * f * (3.0 - 2.0 * f);
+	f = mix(f, sharp, normal * strength);
+
+	fragColor = mix(mix(a, b, f.x), mix(c, d, f.x), f.y);
+}
@@ -0,0 +1,192 @@
+#include <cstdint>
+#include <cstdio>
+
+#include <vma/vk_mem_alloc.h>
+#include <vulkan/vulkan_core.h>
+
+#include "staging_pool.h"
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+bool StagingPool::_chunkCreate(VkDeviceSize size) {
+	if (m_chunkCount == MAX_STAGING_CHUNKS)
+		return false;
+
+	VkBufferCreateInfo createInfo = {
+		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.size = size,
+		.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+	};
+
+	VmaAllocationCreateInfo allocCreateInfo = {
+		.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+		.usage = VMA_MEMORY_USAGE_AUTO,
+	};
+
+	Chunk chunk = {};
+	VmaAllocationInfo allocInfo;
+
+	if (vmaCreateBuffer(m_allocator, &createInfo, &allocCreateInfo, &chunk.buffer.handle, &chunk.buffer.allocation,
+				&allocInfo) != VK_SUCCESS) {
+		printf("Staging chunk allocation failed!\n");
+		return false;
+	}
+
+	chunk.data = allocInfo.pMappedData;
+	chunk.size = size;
+
+	m_chunks[m_chunkCount] = chunk;
+	m_chunkCount += 1;
+	m_memoryUsed += size;
+	return true;
+}
+
+bool StagingPool::_suballocate(VkDeviceSize size, VkDeviceSize alignment, StagingAllocation *allocation) {
+	for (uint32_t i = 0; i < m_chunkCount; i++) {
+		Chunk &chunk = m_chunks[i];
+		VkDeviceSize offset = alignUp(chunk.head, alignment);
+
+		if (offset + size > chunk.size)
+			continue;
+
+		chunk.head = offset + size;
+		chunk.recording = true;
+
+		allocation->buffer = chunk.buffer.handle;
+		allocation->offset = offset;
+		allocation->data = (uint8_t *)chunk.data + offset;
+		allocation->allocation = chunk.buffer.allocation;
+		return true;
+	}
+
+	return false;
+}
+
+bool StagingPool::_waitOldest() {
+	// any retired fence will do, submissions on one queue finish in order anyway
+	for (uint32_t i = 0; i < m_chunkCount; i++) {
+		if (m_chunks[i].fence == VK_NULL_HANDLE || m_chunks[i].recording)
+			continue;
+
+		vkWaitForFences(m_device, 1, &m_chunks[i].fence, VK_TRUE, UINT64_MAX);
+		collect();
+		return true;
+	}
+
+	return false;
+}
+
+void StagingPool::create(VkDevice device, VmaAllocator allocator, VkDeviceSize chunkSize, VkDeviceSize memoryCap) {
+	m_device = device;
+	m_allocator = allocator;
+	m_chunkSize = chunkSize;
+	m_memoryCap = memoryCap;
+}
+
+void StagingPool::destroy() {
+	for (uint32_t i = 0; i < m_chunkCount; i++)
+		vmaDestroyBuffer(m_allocator, m_chunks[i].buffer.handle, m_chunks[i].buffer.allocation);
+
+	m_chunkCount = 0;
+	m_memoryUsed = 0;
+}
+
+VkDeviceSize StagingPool::memoryCap() const {
+	return m_memoryCap;
+}
+
+VkDeviceSize StagingPool::memoryUsed() const {
+	return m_memoryUsed;
+}
+
+void StagingPool::memoryCapSet(VkDeviceSize memoryCap) {
+	m_memoryCap = memoryCap;
+	collect();
+}
+
+bool StagingPool::allocate(VkDeviceSize size, VkDeviceSize alignment, StagingAllocation *allocation) {
+	collect();
+
+	while (true) {
+		if (_suballocate(size, alignment, allocation))
+			return true;
+
+		// oversized requests get a chunk of their own
+		VkDeviceSize chunkSize = size > m_chunkSize ? size : m_chunkSize;
+
+		if (m_memoryUsed + chunkSize <= m_memoryCap && _chunkCreate(chunkSize))
+			continue;
+
+		// back-pressure, the caller waits for earlier uploads instead of growing past the cap
+		if (_waitOldest())
+			continue;
+
+		// nothing left to wait for, everything is taken by uploads not submitted yet
+		if (m_chunkCount == 0 || size > m_memoryCap) {
+			printf("Staging request of %llu bytes exceeds the staging memory cap!\n", (unsigned long long)size);
+
+			if (_chunkCreate(size))
+				continue;
+		}
+
+		return false;
+	}
+}
+
+void StagingPool::flush(const StagingAllocation &allocation, VkDeviceSize size) {
+	vmaFlushAllocation(m_allocator, allocation.allocation, allocation.offset, size);
+}
+
+void StagingPool::retire(VkFence fence) {
+	for (uint32_t i = 0; i < m_chunkCount; i++) {
+		Chunk &chunk = m_chunks[i];
+
+		if (!chunk.recording)
+			continue;
+
+		chunk.recording = false;
+
+		// a completed submission says nothing about an earlier one still reading the chunk
+		if (fence != VK_NULL_HANDLE)
+			chunk.fence = fence;
+	}
+}
+
+void StagingPool::collect() {
+	uint32_t i = 0;
+
+	while (i < m_chunkCount) {
+		Chunk &chunk = m_chunks[i];
+
+		if (chunk.fence != VK_NULL_HANDLE) {
+			if (vkGetFenceStatus(m_device, chunk.fence) != VK_SUCCESS) {
+				i++;
+				continue;
+			}
+
+			// dropped even while recording, fences are reused and a reset one would never signal for it
+			chunk.fence = VK_NULL_HANDLE;
+		}
+
+		if (chunk.recording) {
+			i++;
+			continue;
+		}
+
+		chunk.head = 0;
+
+		// idle and over the cap, e.g. after a one-off oversized upload
+		if (m_memoryUsed > m_memoryCap) {
+			vmaDestroyBuffer(m_allocator, chunk.buffer.handle, chunk.buffer.allocation);
+			m_memoryUsed -= chunk.size;
+
+			m_chunkCount -= 1;
+			m_chunks[i] = m_chunks[m_chunkCount];
+			continue;
+		}
+
+		i++;
+	}
+}
@@ -0,0 +1,73 @@
+#ifndef STAGING_POOL_H
+#define STAGING_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <vulkan/vulkan_core.h>
+
+#include "types/allocated.h"
+
+const uint32_t MAX_STAGING_CHUNKS = 16;
+
+typedef struct VmaAllocator_T *VmaAllocator;
+
+typedef struct {
+	VkBuffer buffer;
+	VkDeviceSize offset;
+	// persistently mapped, write through this and flush before the copy is submitted
+	void *data;
+	VmaAllocation allocation;
+} StagingAllocation;
+
+// Upload memory in large persistently mapped chunks. Allocations are carved out
+// of a chunk linearly and a chunk is only rewound once every upload that used it
+// has retired, so steady streaming creates no new buffers at all.
+class StagingPool {
+private:
+	typedef struct {
+		AllocatedBuffer buffer;
+		void *data;
+		VkDeviceSize size;
+		VkDeviceSize head;
+		// the last submission reading from the chunk, null once it is known to be done
+		VkFence fence;
+		// written since the last retire(), no fence covers it yet
+		bool recording;
+	} Chunk;
+
+	VkDevice m_device = VK_NULL_HANDLE;
+	VmaAllocator m_allocator = nullptr;
+
+	VkDeviceSize m_chunkSize = 0;
+	VkDeviceSize m_memoryCap = 0;
+	VkDeviceSize m_memoryUsed = 0;
+
+	Chunk m_chunks[MAX_STAGING_CHUNKS];
+	uint32_t m_chunkCount = 0;
+
+	bool _chunkCreate(VkDeviceSize size);
+	bool _suballocate(VkDeviceSize size, VkDeviceSize alignment, StagingAllocation *allocation);
+	bool _waitOldest();
+
+public:
+	void create(VkDevice device, VmaAllocator allocator, VkDeviceSize chunkSize, VkDeviceSize memoryCap);
+	void destroy();
+
+	VkDeviceSize memoryCap() const;
+	VkDeviceSize memoryUsed() const;
+	// lowering it frees idle chunks right away, busy ones once they retire
+	void memoryCapSet(VkDeviceSize memoryCap);
+
+	// blocks on retired uploads when the cap is reached, fails when only unsubmitted ones hold the memory
+	bool allocate(VkDeviceSize size, VkDeviceSize alignment, StagingAllocation *allocation);
+	void flush(const StagingAllocation &allocation, VkDeviceSize size);
+
+	// everything allocated since the last call is read by the submission signaling the fence,
+	// VK_NULL_HANDLE when that submission already completed; the fence has to be submitted already
+	void retire(VkFence fence);
+	// rewinds chunks whose uploads have finished, call it before resetting a fence that was retired with
+	void collect();
+};
+
+#endif // !STAGING_POOL_H
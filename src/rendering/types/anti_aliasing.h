@@ -0,0 +1,12 @@
+#ifndef ANTI_ALIASING_H
+#define ANTI_ALIASING_H
+
+typedef enum {
+	ANTI_ALIASING_OFF,
+	ANTI_ALIASING_MSAA_2X,
+	ANTI_ALIASING_MSAA_4X,
+	ANTI_ALIASING_MSAA_8X,
+	ANTI_ALIASING_FXAA,
+} AntiAliasing;
+
+#endif // !ANTI_ALIASING_H
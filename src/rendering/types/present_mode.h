@@ -0,0 +1,11 @@
+#ifndef PRESENT_MODE_H
+#define PRESENT_MODE_H
+
+typedef enum {
+	PRESENT_MODE_FIFO,
+	PRESENT_MODE_FIFO_RELAXED,
+	PRESENT_MODE_MAILBOX,
+	PRESENT_MODE_IMMEDIATE,
+} PresentMode;
+
+#endif // !PRESENT_MODE_H
@@ -0,0 +1,11 @@
+#ifndef SCENE_SNAPSHOT_H
+#define SCENE_SNAPSHOT_H
+
+#include "math/transform.h"
+
+// everything the simulation hands to the renderer once per step
+typedef struct {
+	Transform sprite;
+} SceneSnapshot;
+
+#endif // !SCENE_SNAPSHOT_H
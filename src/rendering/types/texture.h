@@ -0,0 +1,26 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include <cstdint>
+
+#include "allocated.h"
+
+typedef struct VkImageView_T *VkImageView;
+typedef struct VkDescriptorSet_T *VkDescriptorSet;
+
+typedef struct {
+	AllocatedImage image;
+	VkImageView view;
+	// sampler and image, bound as set 1 of the sprite pipeline
+	VkDescriptorSet set;
+	uint32_t width;
+	uint32_t height;
+	uint32_t mipLevels;
+	// device memory behind the images
+	uint64_t memorySize;
+	// tiled textures only, image holds the page cache and this the slot of every page
+	AllocatedImage pageTable;
+	VkImageView pageTableView;
+} Texture;
+
+#endif // !TEXTURE_H
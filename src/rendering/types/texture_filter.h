@@ -0,0 +1,11 @@
+#ifndef TEXTURE_FILTER_H
+#define TEXTURE_FILTER_H
+
+typedef enum {
+	// sharp texels at any zoom, for pixel art
+	TEXTURE_FILTER_NEAREST,
+	// blends texels and mip levels, smooth when scaled down
+	TEXTURE_FILTER_TRILINEAR,
+} TextureFilter;
+
+#endif // !TEXTURE_FILTER_H
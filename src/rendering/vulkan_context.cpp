@@ -21,6 +21,30 @@ const char *DEVICE_EXTENSIONS[1] = {
 	VK_KHR_SWAPCHAIN_EXTENSION_NAME,
 };
 
+// lets optional device features be queried before they are enabled
+const char *FEATURE_QUERY_EXTENSIONS[1] = {
+	VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME,
+};
+
+// needed by VK_EXT_swapchain_maintenance1, enabled only when both are available
+const char *SURFACE_MAINTENANCE_EXTENSIONS[2] = {
+	VK_KHR_GET_SURFACE_CAPABILITIES_2_EXTENSION_NAME,
+	VK_EXT_SURFACE_MAINTENANCE_1_EXTENSION_NAME,
+};
+
+// waiting on a present tells when a frame actually reached the display
+const char *PRESENT_WAIT_EXTENSIONS[2] = {
+	VK_KHR_PRESENT_ID_EXTENSION_NAME,
+	VK_KHR_PRESENT_WAIT_EXTENSION_NAME,
+};
+
+// reports how much device memory the process may use before the system starts paging it out
+const char *MEMORY_BUDGET_EXTENSIONS[1] = {
+	VK_EXT_MEMORY_BUDGET_EXTENSION_NAME,
+};
+
+const uint32_t MAX_DEVICE_EXTENSIONS = 8;
+
 typedef struct {
 	VkSurfaceCapabilitiesKHR capabilities;
 	uint32_t surfaceFormatCount;
@@ -32,6 +56,8 @@ typedef struct {
 struct QueueFamilyIndices {
 	uint32_t graphicsFamily = UINT32_MAX;
 	uint32_t presentFamily = UINT32_MAX;
+	// optional, copies on a family without graphics run beside rendering
+	uint32_t transferFamily = UINT32_MAX;
 
 	bool isComplete() {
 		return graphicsFamily != UINT32_MAX && presentFamily != UINT32_MAX;
@@ -69,6 +95,35 @@ void DestroyDebugUtilsMessengerEXT(
 	}
 }
 
+VkResult GetPhysicalDeviceSurfaceCapabilities2KHR(VkInstance instance, VkPhysicalDevice physicalDevice,
+		const VkPhysicalDeviceSurfaceInfo2KHR *surfaceInfo, VkSurfaceCapabilities2KHR *surfaceCapabilities) {
+	PFN_vkGetPhysicalDeviceSurfaceCapabilities2KHR func = (PFN_vkGetPhysicalDeviceSurfaceCapabilities2KHR)
+			vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceSurfaceCapabilities2KHR");
+	if (func != nullptr)
+		return func(physicalDevice, surfaceInfo, surfaceCapabilities);
+
+	return VK_ERROR_EXTENSION_NOT_PRESENT;
+}
+
+void GetPhysicalDeviceFeatures2KHR(
+		VkInstance instance, VkPhysicalDevice physicalDevice, VkPhysicalDeviceFeatures2KHR *features) {
+	PFN_vkGetPhysicalDeviceFeatures2KHR func =
+			(PFN_vkGetPhysicalDeviceFeatures2KHR)vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2KHR");
+	if (func != nullptr) {
+		func(physicalDevice, features);
+	}
+}
+
+static bool isExtensionAvailable(
+		const char *extensionName, const VkExtensionProperties *extensionProperties, uint32_t extensionPropertyCount) {
+	for (uint32_t i = 0; i < extensionPropertyCount; i++) {
+		if (strcmp(extensionName, extensionProperties[i].extensionName) == 0)
+			return true;
+	}
+
+	return false;
+}
+
 static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
 		VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT *callbackData,
 		void *pUserData) {
@@ -80,8 +135,27 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityF
 	return VK_FALSE;
 }
 
+bool checkInstanceExtensionSupport(const char *const *extensionNames, uint32_t extensionNameCount) {
+	uint32_t extensionPropertyCount = 0;
+	vkEnumerateInstanceExtensionProperties(nullptr, &extensionPropertyCount, nullptr);
+
+	VkExtensionProperties *extensionProperties = new VkExtensionProperties[extensionPropertyCount];
+	vkEnumerateInstanceExtensionProperties(nullptr, &extensionPropertyCount, extensionProperties);
+
+	bool supported = true;
+	for (uint32_t i = 0; i < extensionNameCount; i++) {
+		if (!isExtensionAvailable(extensionNames[i], extensionProperties, extensionPropertyCount)) {
+			supported = false;
+			break;
+		}
+	}
+
+	delete[] extensionProperties;
+	return supported;
+}
+
 VkInstance instanceCreate(const char *const *extensions, uint32_t extensionCount, bool validation,
-		VkDebugUtilsMessengerEXT *debugMessenger) {
+		VkDebugUtilsMessengerEXT *debugMessenger, bool *featureQuery, bool *surfaceMaintenance) {
 	uint32_t appVersion = VK_MAKE_VERSION(0, 1, 0);
 
 	VkApplicationInfo appInfo = {
@@ -93,17 +167,42 @@ VkInstance instanceCreate(const char *const *extensions, uint32_t extensionCount
 		.apiVersion = VK_API_VERSION_1_0,
 	};
 
+	uint32_t featureQueryExtensionCount = sizeof(FEATURE_QUERY_EXTENSIONS) / sizeof(FEATURE_QUERY_EXTENSIONS[0]);
+	uint32_t surfaceMaintenanceExtensionCount =
+			sizeof(SURFACE_MAINTENANCE_EXTENSIONS) / sizeof(SURFACE_MAINTENANCE_EXTENSIONS[0]);
+
 	uint32_t enabledExtensionCount = extensionCount;
-	const char **enabledExtensions = (const char **)malloc((extensionCount + 1) * sizeof(const char *));
+	const char **enabledExtensions = (const char **)malloc(
+			(extensionCount + featureQueryExtensionCount + surfaceMaintenanceExtensionCount + 1) *
+			sizeof(const char *));
 
 	for (uint32_t i = 0; i < extensionCount; i++)
 		enabledExtensions[i] = extensions[i];
 
 	if (validation) {
-		enabledExtensions[extensionCount] = VK_EXT_DEBUG_UTILS_EXTENSION_NAME;
+		enabledExtensions[enabledExtensionCount] = VK_EXT_DEBUG_UTILS_EXTENSION_NAME;
 		enabledExtensionCount += 1;
 	}
 
+	*featureQuery = checkInstanceExtensionSupport(FEATURE_QUERY_EXTENSIONS, featureQueryExtensionCount);
+
+	if (*featureQuery) {
+		for (const char *extensionName : FEATURE_QUERY_EXTENSIONS) {
+			enabledExtensions[enabledExtensionCount] = extensionName;
+			enabledExtensionCount += 1;
+		}
+	}
+
+	*surfaceMaintenance =
+			checkInstanceExtensionSupport(SURFACE_MAINTENANCE_EXTENSIONS, surfaceMaintenanceExtensionCount);
+
+	if (*surfaceMaintenance) {
+		for (const char *extensionName : SURFACE_MAINTENANCE_EXTENSIONS) {
+			enabledExtensions[enabledExtensionCount] = extensionName;
+			enabledExtensionCount += 1;
+		}
+	}
+
 	VkInstanceCreateInfo createInfo = {
 		.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
 		.pApplicationInfo = &appInfo,
@@ -138,6 +237,8 @@ VkInstance instanceCreate(const char *const *extensions, uint32_t extensionCount
 	VkInstance instance;
 	CHECK_VK_RESULT(vkCreateInstance(&createInfo, nullptr, &instance) == VK_SUCCESS, "Instance creation failed!");
 
+	free(enabledExtensions);
+
 	if (validation) {
 		CHECK_VK_RESULT(CreateDebugUtilsMessengerEXT(instance, &debugCreateInfo, nullptr, debugMessenger) == VK_SUCCESS,
 				"DebugUtilsMessenger creation failed!");
@@ -172,6 +273,22 @@ QueueFamilyIndices findQueueFamilies(VkPhysicalDevice physicalDevice, VkSurfaceK
 		}
 	}
 
+	// a dedicated DMA family is best, one shared with async compute still beats the graphics queue
+	const VkQueueFlags TRANSFER_EXCLUSIONS[] = {
+		VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT,
+		VK_QUEUE_GRAPHICS_BIT,
+	};
+
+	for (VkQueueFlags exclusions : TRANSFER_EXCLUSIONS) {
+		for (uint32_t i = 0; i < queueFamilyPropertyCount && indices.transferFamily == UINT32_MAX; i++) {
+			VkQueueFlags flags = queueFamilyProperties[i].queueFlags;
+
+			if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & exclusions))
+				indices.transferFamily = i;
+		}
+	}
+
+	delete[] queueFamilyProperties;
 	return indices;
 }
 
@@ -183,16 +300,7 @@ bool checkDeviceExtensionSupport(VkPhysicalDevice physicalDevice) {
 	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionPropertyCount, extensionProperties);
 
 	for (const char *extensionName : DEVICE_EXTENSIONS) {
-		bool extensionFound = false;
-
-		for (uint32_t i = 0; i < extensionPropertyCount; i++) {
-			if (strcmp(extensionName, extensionProperties[i].extensionName) != 0)
-				continue;
-
-			extensionFound = true;
-		}
-
-		if (extensionFound)
+		if (isExtensionAvailable(extensionName, extensionProperties, extensionPropertyCount))
 			continue;
 
 		// not found
@@ -202,6 +310,69 @@ bool checkDeviceExtensionSupport(VkPhysicalDevice physicalDevice) {
 	return true;
 }
 
+bool checkOptionalDeviceExtensionSupport(
+		VkPhysicalDevice physicalDevice, const char *const *extensionNames, uint32_t extensionNameCount) {
+	uint32_t extensionPropertyCount = 0;
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionPropertyCount, nullptr);
+
+	VkExtensionProperties *extensionProperties = new VkExtensionProperties[extensionPropertyCount];
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionPropertyCount, extensionProperties);
+
+	bool supported = true;
+	for (uint32_t i = 0; i < extensionNameCount; i++) {
+		if (!isExtensionAvailable(extensionNames[i], extensionProperties, extensionPropertyCount)) {
+			supported = false;
+			break;
+		}
+	}
+
+	delete[] extensionProperties;
+	return supported;
+}
+
+bool checkSwapchainMaintenanceSupport(VkInstance instance, VkPhysicalDevice physicalDevice) {
+	const char *extensionName = VK_EXT_SWAPCHAIN_MAINTENANCE_1_EXTENSION_NAME;
+
+	if (!checkOptionalDeviceExtensionSupport(physicalDevice, &extensionName, 1))
+		return false;
+
+	VkPhysicalDeviceSwapchainMaintenance1FeaturesEXT maintenanceFeatures = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SWAPCHAIN_MAINTENANCE_1_FEATURES_EXT,
+	};
+
+	VkPhysicalDeviceFeatures2KHR features = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR,
+		.pNext = &maintenanceFeatures,
+	};
+
+	GetPhysicalDeviceFeatures2KHR(instance, physicalDevice, &features);
+	return maintenanceFeatures.swapchainMaintenance1 == VK_TRUE;
+}
+
+bool checkPresentWaitSupport(VkInstance instance, VkPhysicalDevice physicalDevice) {
+	uint32_t extensionCount = sizeof(PRESENT_WAIT_EXTENSIONS) / sizeof(PRESENT_WAIT_EXTENSIONS[0]);
+
+	if (!checkOptionalDeviceExtensionSupport(physicalDevice, PRESENT_WAIT_EXTENSIONS, extensionCount))
+		return false;
+
+	VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR,
+	};
+
+	VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR,
+		.pNext = &presentWaitFeatures,
+	};
+
+	VkPhysicalDeviceFeatures2KHR features = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR,
+		.pNext = &presentIdFeatures,
+	};
+
+	GetPhysicalDeviceFeatures2KHR(instance, physicalDevice, &features);
+	return presentIdFeatures.presentId == VK_TRUE && presentWaitFeatures.presentWait == VK_TRUE;
+}
+
 SwapchainSupportDetails querySwapchainSupportDetails(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface) {
 	VkSurfaceCapabilitiesKHR capabilities;
 	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, surface, &capabilities);
@@ -215,7 +386,7 @@ SwapchainSupportDetails querySwapchainSupportDetails(VkPhysicalDevice physicalDe
 	uint32_t surfaceFormatCount = 0;
 	vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, surface, &surfaceFormatCount, nullptr);
 
-	VkSurfaceFormatKHR *surfaceFormats = new VkSurfaceFormatKHR[presentModeCount];
+	VkSurfaceFormatKHR *surfaceFormats = new VkSurfaceFormatKHR[surfaceFormatCount];
 	vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, surface, &surfaceFormatCount, surfaceFormats);
 
 	SwapchainSupportDetails details = {
@@ -229,6 +400,29 @@ SwapchainSupportDetails querySwapchainSupportDetails(VkPhysicalDevice physicalDe
 	return details;
 }
 
+// capabilities for a specific present mode, optionally with the modes it can be switched to in place
+VkSurfaceCapabilitiesKHR queryPresentModeCapabilities(VkInstance instance, VkPhysicalDevice physicalDevice,
+		VkSurfaceKHR surface, VkPresentModeKHR presentMode, VkSurfacePresentModeCompatibilityEXT *compatibility) {
+	VkSurfacePresentModeEXT surfacePresentMode = {
+		.sType = VK_STRUCTURE_TYPE_SURFACE_PRESENT_MODE_EXT,
+		.presentMode = presentMode,
+	};
+
+	VkPhysicalDeviceSurfaceInfo2KHR surfaceInfo = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SURFACE_INFO_2_KHR,
+		.pNext = &surfacePresentMode,
+		.surface = surface,
+	};
+
+	VkSurfaceCapabilities2KHR capabilities = {
+		.sType = VK_STRUCTURE_TYPE_SURFACE_CAPABILITIES_2_KHR,
+		.pNext = compatibility,
+	};
+
+	GetPhysicalDeviceSurfaceCapabilities2KHR(instance, physicalDevice, &surfaceInfo, &capabilities);
+	return capabilities.surfaceCapabilities;
+}
+
 bool isDeviceSuitable(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface) {
 	QueueFamilyIndices indices = findQueueFamilies(physicalDevice, surface);
 	bool extensionsSupported = checkDeviceExtensionSupport(physicalDevice);
@@ -260,39 +454,102 @@ VkPhysicalDevice pickPhysicalDevice(VkInstance instance, VkSurfaceKHR surface) {
 	return VK_NULL_HANDLE;
 }
 
-VkDevice deviceCreate(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, bool validation) {
+VkDevice deviceCreate(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, bool validation, bool swapchainMaintenance,
+		bool presentWait, bool memoryBudget, bool textureCompressionBC) {
 	QueueFamilyIndices indices = findQueueFamilies(physicalDevice, surface);
 
-	uint32_t queueCreateInfoCount = 2;
+	// a family may serve several roles, each one gets a single create info
+	uint32_t families[] = { indices.graphicsFamily, indices.presentFamily, indices.transferFamily };
+
+	uint32_t queueCreateInfoCount = 0;
 	float queuePriority = 1.0f;
-	VkDeviceQueueCreateInfo queueCreateInfos[2];
+	VkDeviceQueueCreateInfo queueCreateInfos[3];
 
-	queueCreateInfos[0] = {
-		.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
-		.queueFamilyIndex = indices.graphicsFamily,
-		.queueCount = 1,
-		.pQueuePriorities = &queuePriority,
+	for (uint32_t family : families) {
+		if (family == UINT32_MAX)
+			continue;
+
+		bool duplicate = false;
+		for (uint32_t i = 0; i < queueCreateInfoCount; i++) {
+			if (queueCreateInfos[i].queueFamilyIndex == family)
+				duplicate = true;
+		}
+
+		if (duplicate)
+			continue;
+
+		queueCreateInfos[queueCreateInfoCount] = {
+			.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+			.queueFamilyIndex = family,
+			.queueCount = 1,
+			.pQueuePriorities = &queuePriority,
+		};
+
+		queueCreateInfoCount += 1;
+	}
+
+	uint32_t enabledExtensionCount = 0;
+	const char *enabledExtensions[MAX_DEVICE_EXTENSIONS];
+
+	for (const char *extensionName : DEVICE_EXTENSIONS) {
+		enabledExtensions[enabledExtensionCount] = extensionName;
+		enabledExtensionCount += 1;
+	}
+
+	VkPhysicalDeviceSwapchainMaintenance1FeaturesEXT maintenanceFeatures = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SWAPCHAIN_MAINTENANCE_1_FEATURES_EXT,
+		.swapchainMaintenance1 = VK_TRUE,
 	};
 
-	queueCreateInfos[1] = {
-		.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
-		.queueFamilyIndex = indices.presentFamily,
-		.queueCount = 1,
-		.pQueuePriorities = &queuePriority,
+	VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR,
+		.presentId = VK_TRUE,
 	};
 
-	if (indices.graphicsFamily == indices.presentFamily)
-		queueCreateInfoCount = 1;
+	VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR,
+		.presentWait = VK_TRUE,
+	};
 
-	uint32_t enabledExtensionCount = sizeof(DEVICE_EXTENSIONS) / sizeof(DEVICE_EXTENSIONS[0]);
-	const char **enabledExtensions = DEVICE_EXTENSIONS;
+	void *next = nullptr;
+
+	if (swapchainMaintenance) {
+		enabledExtensions[enabledExtensionCount] = VK_EXT_SWAPCHAIN_MAINTENANCE_1_EXTENSION_NAME;
+		enabledExtensionCount += 1;
+
+		maintenanceFeatures.pNext = next;
+		next = &maintenanceFeatures;
+	}
+
+	if (presentWait) {
+		for (const char *extensionName : PRESENT_WAIT_EXTENSIONS) {
+			enabledExtensions[enabledExtensionCount] = extensionName;
+			enabledExtensionCount += 1;
+		}
+
+		presentIdFeatures.pNext = next;
+		presentWaitFeatures.pNext = &presentIdFeatures;
+		next = &presentWaitFeatures;
+	}
+
+	if (memoryBudget) {
+		for (const char *extensionName : MEMORY_BUDGET_EXTENSIONS) {
+			enabledExtensions[enabledExtensionCount] = extensionName;
+			enabledExtensionCount += 1;
+		}
+	}
+
+	VkPhysicalDeviceFeatures enabledFeatures = {};
+	enabledFeatures.textureCompressionBC = textureCompressionBC ? VK_TRUE : VK_FALSE;
 
 	VkDeviceCreateInfo createInfo = {
 		.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+		.pNext = next,
 		.queueCreateInfoCount = queueCreateInfoCount,
 		.pQueueCreateInfos = queueCreateInfos,
 		.enabledExtensionCount = enabledExtensionCount,
 		.ppEnabledExtensionNames = enabledExtensions,
+		.pEnabledFeatures = &enabledFeatures,
 	};
 
 	VkDevice device;
@@ -331,7 +588,7 @@ VkSurfaceFormatKHR chooseSurfaceFormat(VkSurfaceFormatKHR *surfaceFormats, uint3
 	assert(surfaceFormatCount != 0 && surfaceFormats != nullptr);
 
 	for (uint32_t i = 0; i < surfaceFormatCount; i++) {
-		if (surfaceFormats[i].format != VK_FORMAT_B8G8R8_SRGB ||
+		if (surfaceFormats[i].format != VK_FORMAT_B8G8R8A8_SRGB ||
 				surfaceFormats[i].colorSpace != VK_COLOR_SPACE_SRGB_NONLINEAR_KHR)
 			continue;
 
@@ -443,7 +700,33 @@ void VulkanContext::_swapchainCreate(uint32_t width, uint32_t height) {
 		m_swapchainExtent = { _width, _height };
 	}
 
+	VkPresentModeKHR presentMode =
+			choosePresentMode(details.presentModes, details.presentModeCount, m_desiredPresentMode);
+
 	uint32_t minImageCount = details.capabilities.minImageCount + 1;
+	if (m_desiredImageCount > 0)
+		minImageCount = max(m_desiredImageCount, details.capabilities.minImageCount);
+
+	m_compatiblePresentModeCount = 0;
+
+	if (m_swapchainMaintenance) {
+		VkSurfacePresentModeCompatibilityEXT compatibility = {
+			.sType = VK_STRUCTURE_TYPE_SURFACE_PRESENT_MODE_COMPATIBILITY_EXT,
+			.presentModeCount = MAX_PRESENT_MODES,
+			.pPresentModes = m_compatiblePresentModes,
+		};
+
+		queryPresentModeCapabilities(m_instance, m_physicalDevice, m_surface, presentMode, &compatibility);
+		m_compatiblePresentModeCount = compatibility.presentModeCount;
+
+		// every mode the swapchain may switch to has to work with the image count it is created with
+		for (uint32_t i = 0; i < m_compatiblePresentModeCount; i++) {
+			VkSurfaceCapabilitiesKHR capabilities = queryPresentModeCapabilities(
+					m_instance, m_physicalDevice, m_surface, m_compatiblePresentModes[i], nullptr);
+			minImageCount = max(minImageCount, capabilities.minImageCount);
+		}
+	}
+
 	if (details.capabilities.maxImageCount > 0 && minImageCount > details.capabilities.maxImageCount) {
 		minImageCount = details.capabilities.maxImageCount;
 	}
@@ -460,11 +743,16 @@ void VulkanContext::_swapchainCreate(uint32_t width, uint32_t height) {
 	}
 
 	VkSurfaceFormatKHR surfaceFormat = chooseSurfaceFormat(details.surfaceFormats, details.surfaceFormatCount);
-	VkPresentModeKHR presentMode =
-			choosePresentMode(details.presentModes, details.presentModeCount, VK_PRESENT_MODE_MAILBOX_KHR);
+
+	VkSwapchainPresentModesCreateInfoEXT presentModesInfo = {
+		.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_PRESENT_MODES_CREATE_INFO_EXT,
+		.presentModeCount = m_compatiblePresentModeCount,
+		.pPresentModes = m_compatiblePresentModes,
+	};
 
 	VkSwapchainCreateInfoKHR createInfo = {
 		.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
+		.pNext = m_compatiblePresentModeCount > 0 ? &presentModesInfo : nullptr,
 		.surface = m_surface,
 		.minImageCount = minImageCount,
 		.imageFormat = surfaceFormat.format,
@@ -484,6 +772,8 @@ void VulkanContext::_swapchainCreate(uint32_t width, uint32_t height) {
 	CHECK_VK_RESULT(vkCreateSwapchainKHR(m_device, &createInfo, nullptr, &m_swapchain) == VK_SUCCESS,
 			"Swapchain creation failed!");
 
+	m_presentMode = presentMode;
+
 	uint32_t swapchainImageCount = 0;
 	vkGetSwapchainImagesKHR(m_device, m_swapchain, &swapchainImageCount, nullptr);
 
@@ -580,6 +870,10 @@ VkPhysicalDevice VulkanContext::physicalDevice() const {
 	return m_physicalDevice;
 }
 
+VkPhysicalDeviceProperties VulkanContext::properties() const {
+	return m_properties;
+}
+
 VkPhysicalDeviceMemoryProperties VulkanContext::memoryProperties() const {
 	return m_memoryProperties;
 }
@@ -600,6 +894,14 @@ uint32_t VulkanContext::graphicsQueueFamily() const {
 	return m_graphicsQueueFamily;
 }
 
+VkQueue VulkanContext::transferQueue() const {
+	return m_transferQueue;
+}
+
+uint32_t VulkanContext::transferQueueFamily() const {
+	return m_transferQueueFamily;
+}
+
 VkSwapchainKHR VulkanContext::swapchain() const {
 	return m_swapchain;
 }
@@ -608,6 +910,33 @@ VkExtent2D VulkanContext::swapchainExtent() const {
 	return m_swapchainExtent;
 }
 
+VkPresentModeKHR VulkanContext::presentMode() const {
+	return m_presentMode;
+}
+
+bool VulkanContext::isPresentModeSwitchable() const {
+	return m_compatiblePresentModeCount > 0;
+}
+
+bool VulkanContext::isPresentWaitSupported() const {
+	return m_waitForPresent != nullptr;
+}
+
+bool VulkanContext::isMemoryBudgetSupported() const {
+	return m_memoryBudget;
+}
+
+bool VulkanContext::isTextureCompressionBCSupported() const {
+	return m_textureCompressionBC;
+}
+
+VkResult VulkanContext::presentWait(uint64_t presentId, uint64_t timeout) const {
+	if (m_waitForPresent == nullptr)
+		return VK_ERROR_EXTENSION_NOT_PRESENT;
+
+	return m_waitForPresent(m_device, m_swapchain, presentId, timeout);
+}
+
 VkRenderPass VulkanContext::renderPass() const {
 	return m_renderPass;
 }
@@ -620,6 +949,10 @@ VkCommandPool VulkanContext::commandPool() const {
 	return m_commandPool;
 }
 
+VkCommandPool VulkanContext::transferCommandPool() const {
+	return m_transferCommandPool;
+}
+
 void VulkanContext::create(const char *const *extensions, uint32_t extensionCount, bool validation) {
 	if (validation && !checkValidationLayerSupport()) {
 		printf("Validation not supported!\n");
@@ -627,7 +960,8 @@ void VulkanContext::create(const char *const *extensions, uint32_t extensionCoun
 	}
 
 	m_validation = validation;
-	m_instance = instanceCreate(extensions, extensionCount, validation, &m_debugMessenger);
+	m_instance = instanceCreate(
+			extensions, extensionCount, validation, &m_debugMessenger, &m_featureQuery, &m_surfaceMaintenance);
 }
 
 void VulkanContext::destroy() {
@@ -635,6 +969,7 @@ void VulkanContext::destroy() {
 		_swapchainDestroy();
 
 		vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+		vkDestroyCommandPool(m_device, m_transferCommandPool, nullptr);
 		vkDestroyDevice(m_device, nullptr);
 
 		vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
@@ -653,9 +988,26 @@ void VulkanContext::windowCreate(VkSurfaceKHR surface, uint32_t width, uint32_t
 	m_surface = surface;
 
 	m_physicalDevice = pickPhysicalDevice(m_instance, m_surface);
+	vkGetPhysicalDeviceProperties(m_physicalDevice, &m_properties);
 	vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &m_memoryProperties);
 
-	m_device = deviceCreate(m_physicalDevice, m_surface, m_validation);
+	m_swapchainMaintenance = m_featureQuery && m_surfaceMaintenance &&
+			checkSwapchainMaintenanceSupport(m_instance, m_physicalDevice);
+	m_presentWait = m_featureQuery && checkPresentWaitSupport(m_instance, m_physicalDevice);
+
+	uint32_t memoryBudgetExtensionCount = sizeof(MEMORY_BUDGET_EXTENSIONS) / sizeof(MEMORY_BUDGET_EXTENSIONS[0]);
+	m_memoryBudget = m_featureQuery &&
+			checkOptionalDeviceExtensionSupport(m_physicalDevice, MEMORY_BUDGET_EXTENSIONS, memoryBudgetExtensionCount);
+
+	VkPhysicalDeviceFeatures features;
+	vkGetPhysicalDeviceFeatures(m_physicalDevice, &features);
+	m_textureCompressionBC = features.textureCompressionBC == VK_TRUE;
+
+	m_device = deviceCreate(m_physicalDevice, m_surface, m_validation, m_swapchainMaintenance, m_presentWait,
+			m_memoryBudget, m_textureCompressionBC);
+
+	if (m_presentWait)
+		m_waitForPresent = (PFN_vkWaitForPresentKHR)vkGetDeviceProcAddr(m_device, "vkWaitForPresentKHR");
 
 	QueueFamilyIndices indices = findQueueFamilies(m_physicalDevice, m_surface);
 	vkGetDeviceQueue(m_device, indices.graphicsFamily, 0, &m_graphicsQueue);
@@ -663,6 +1015,15 @@ void VulkanContext::windowCreate(VkSurfaceKHR surface, uint32_t width, uint32_t
 
 	m_graphicsQueueFamily = indices.graphicsFamily;
 
+	// without a separate family uploads share the graphics queue
+	m_transferQueue = m_graphicsQueue;
+	m_transferQueueFamily = indices.graphicsFamily;
+
+	if (indices.transferFamily != UINT32_MAX) {
+		vkGetDeviceQueue(m_device, indices.transferFamily, 0, &m_transferQueue);
+		m_transferQueueFamily = indices.transferFamily;
+	}
+
 	_swapchainCreate(width, height);
 
 	VkCommandPoolCreateInfo commandPoolCreateInfo = {
@@ -674,6 +1035,13 @@ void VulkanContext::windowCreate(VkSurfaceKHR surface, uint32_t width, uint32_t
 	CHECK_VK_RESULT(vkCreateCommandPool(m_device, &commandPoolCreateInfo, nullptr, &m_commandPool) == VK_SUCCESS,
 			"CommandPool creation failed!");
 
+	commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	commandPoolCreateInfo.queueFamilyIndex = m_transferQueueFamily;
+
+	CHECK_VK_RESULT(vkCreateCommandPool(m_device, &commandPoolCreateInfo, nullptr, &m_transferCommandPool) ==
+							VK_SUCCESS,
+			"CommandPool creation failed!");
+
 	m_initialized = true;
 }
 
@@ -683,3 +1051,25 @@ void VulkanContext::windowResize(uint32_t width, uint32_t height) {
 	_swapchainDestroy();
 	_swapchainCreate(width, height);
 }
+
+bool VulkanContext::presentModeSet(VkPresentModeKHR presentMode) {
+	m_desiredPresentMode = presentMode;
+
+	if (!m_initialized || presentMode == m_presentMode)
+		return true;
+
+	for (uint32_t i = 0; i < m_compatiblePresentModeCount; i++) {
+		if (m_compatiblePresentModes[i] != presentMode)
+			continue;
+
+		// takes effect with the next present
+		m_presentMode = presentMode;
+		return true;
+	}
+
+	return false;
+}
+
+void VulkanContext::imageCountSet(uint32_t imageCount) {
+	m_desiredImageCount = imageCount;
+}
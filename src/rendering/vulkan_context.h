@@ -3,6 +3,8 @@
 
 #include <vulkan/vulkan_core.h>
 
+const uint32_t MAX_PRESENT_MODES = 8;
+
 class VulkanContext {
 private:
 	bool m_validation = false;
@@ -13,14 +15,40 @@ private:
 	VkSurfaceKHR m_surface;
 
 	VkPhysicalDevice m_physicalDevice;
+	VkPhysicalDeviceProperties m_properties;
 	VkPhysicalDeviceMemoryProperties m_memoryProperties;
 
 	VkDevice m_device;
 
 	VkQueue m_graphicsQueue;
 	VkQueue m_presentQueue;
+	VkQueue m_transferQueue;
 
 	uint32_t m_graphicsQueueFamily;
+	uint32_t m_transferQueueFamily;
+
+	bool m_featureQuery = false;
+
+	// optional, lets present modes of the same group switch without recreating the swapchain
+	bool m_surfaceMaintenance = false;
+	bool m_swapchainMaintenance = false;
+
+	// optional, reports when a present actually happened
+	bool m_presentWait = false;
+	PFN_vkWaitForPresentKHR m_waitForPresent = nullptr;
+
+	// optional, without it the allocator estimates the budget from the heap sizes
+	bool m_memoryBudget = false;
+
+	// optional, BC1 to BC7 textures
+	bool m_textureCompressionBC = false;
+
+	VkPresentModeKHR m_desiredPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+	uint32_t m_desiredImageCount = 0;
+
+	VkPresentModeKHR m_presentMode = VK_PRESENT_MODE_FIFO_KHR;
+	uint32_t m_compatiblePresentModeCount = 0;
+	VkPresentModeKHR m_compatiblePresentModes[MAX_PRESENT_MODES];
 
 	typedef struct {
 		VkImageView view;
@@ -39,6 +67,7 @@ private:
 	VkImageView m_colorImageView;
 
 	VkCommandPool m_commandPool;
+	VkCommandPool m_transferCommandPool;
 
 	bool m_initialized = false;
 
@@ -49,22 +78,39 @@ public:
 	VkInstance instance() const;
 	VkSurfaceKHR surface() const;
 	VkPhysicalDevice physicalDevice() const;
+	VkPhysicalDeviceProperties properties() const;
 	VkPhysicalDeviceMemoryProperties memoryProperties() const;
 	VkDevice device() const;
 	VkQueue graphicsQueue() const;
 	VkQueue presentQueue() const;
 	uint32_t graphicsQueueFamily() const;
+	// the graphics queue when the device has no separate transfer family
+	VkQueue transferQueue() const;
+	uint32_t transferQueueFamily() const;
 	VkSwapchainKHR swapchain() const;
 	VkExtent2D swapchainExtent() const;
+	VkPresentModeKHR presentMode() const;
+	bool isPresentModeSwitchable() const;
+	bool isPresentWaitSupported() const;
+	bool isMemoryBudgetSupported() const;
+	bool isTextureCompressionBCSupported() const;
+	// presents are tagged with increasing ids, this blocks until the one given is on screen
+	VkResult presentWait(uint64_t presentId, uint64_t timeout) const;
 	VkRenderPass renderPass() const;
 	VkFramebuffer framebuffer(uint32_t imageIndex) const;
 	VkCommandPool commandPool() const;
+	VkCommandPool transferCommandPool() const;
 
 	void create(const char *const *extensions, uint32_t extensionCount, bool validation);
 	void destroy();
 
 	void windowCreate(VkSurfaceKHR surface, uint32_t width, uint32_t height);
 	void windowResize(uint32_t width, uint32_t height);
+
+	// returns false when the swapchain has to be recreated for the new mode to apply
+	bool presentModeSet(VkPresentModeKHR presentMode);
+	// 0 picks one more than the surface minimum, applied on the next swapchain recreation
+	void imageCountSet(uint32_t imageCount);
 };
 
 #endif // !VULKAN_CONTEXT_H
@@ -0,0 +1,478 @@
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "block_encoder.h"
+
+const uint32_t BLOCK_TEXELS = 16;
+
+// texels with less alpha are left out of BC1 blocks
+const uint8_t ALPHA_THRESHOLD = 128;
+
+// endpoint weights of BC7 4 bit indices, out of 64
+const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+const uint32_t POWER_ITERATIONS = 8;
+
+static int clampInt(int value, int minimum, int maximum) {
+	return value < minimum ? minimum : (value > maximum ? maximum : value);
+}
+
+static float clampFloat(float value, float minimum, float maximum) {
+	return value < minimum ? minimum : (value > maximum ? maximum : value);
+}
+
+// endpoints at the extremes of the selected texels along the direction they vary the most in
+static void axisEndpoints(const uint8_t *texels, const bool *mask, uint32_t channelCount, float endpoint0[4],
+		float endpoint1[4]) {
+	float mean[4] = {};
+	uint32_t count = 0;
+
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+		if (!mask[i])
+			continue;
+
+		for (uint32_t c = 0; c < 4; c++)
+			mean[c] += texels[i * 4 + c];
+
+		count++;
+	}
+
+	for (uint32_t c = 0; c < 4; c++)
+		mean[c] /= count;
+
+	float covariance[4][4] = {};
+
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+		if (!mask[i])
+			continue;
+
+		for (uint32_t a = 0; a < channelCount; a++) {
+			for (uint32_t b = 0; b < channelCount; b++)
+				covariance[a][b] += (texels[i * 4 + a] - mean[a]) * (texels[i * 4 + b] - mean[b]);
+		}
+	}
+
+	float axis[4] = {};
+	for (uint32_t c = 0; c < channelCount; c++)
+		axis[c] = 1.0f;
+
+	for (uint32_t iteration = 0; iteration < POWER_ITERATIONS; iteration++) {
+		float next[4] = {};
+		float length = 0.0f;
+
+		for (uint32_t a = 0; a < channelCount; a++) {
+			for (uint32_t b = 0; b < channelCount; b++)
+				next[a] += covariance[a][b] * axis[b];
+
+			length = std::fmax(length, std::fabs(next[a]));
+		}
+
+		// a flat block, both endpoints end up on the mean
+		if (length == 0.0f) {
+			memset(axis, 0, sizeof(axis));
+			break;
+		}
+
+		for (uint32_t c = 0; c < channelCount; c++)
+			axis[c] = next[c] / length;
+	}
+
+	float minimum = 0.0f;
+	float maximum = 0.0f;
+
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+		if (!mask[i])
+			continue;
+
+		float projection = 0.0f;
+		for (uint32_t c = 0; c < channelCount; c++)
+			projection += (texels[i * 4 + c] - mean[c]) * axis[c];
+
+		minimum = std::fmin(minimum, projection);
+		maximum = std::fmax(maximum, projection);
+	}
+
+	// the axis is not normalized, the projections are scaled by its squared length
+	float lengthSquared = 0.0f;
+	for (uint32_t c = 0; c < channelCount; c++)
+		lengthSquared += axis[c] * axis[c];
+
+	if (lengthSquared > 0.0f) {
+		minimum /= lengthSquared;
+		maximum /= lengthSquared;
+	}
+
+	for (uint32_t c = 0; c < 4; c++) {
+		endpoint0[c] = clampFloat(mean[c] + minimum * axis[c], 0.0f, 255.0f);
+		endpoint1[c] = clampFloat(mean[c] + maximum * axis[c], 0.0f, 255.0f);
+	}
+}
+
+// endpoints with the least squared error for the given weights, a weight of 0 means the first endpoint
+static bool leastSquaresEndpoints(const uint8_t *texels, const bool *mask, const float *weights,
+		uint32_t channelCount, float endpoint0[4], float endpoint1[4]) {
+	float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+	float ax[4] = {};
+	float bx[4] = {};
+
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+		if (!mask[i])
+			continue;
+
+		float b = weights[i];
+		float a = 1.0f - b;
+
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+
+		for (uint32_t c = 0; c < channelCount; c++) {
+			ax[c] += a * texels[i * 4 + c];
+			bx[c] += b * texels[i * 4 + c];
+		}
+	}
+
+	// every texel on the same index, nothing to fit
+	float determinant = aa * bb - ab * ab;
+	if (std::fabs(determinant) < 1e-6f)
+		return false;
+
+	for (uint32_t c = 0; c < channelCount; c++) {
+		endpoint0[c] = clampFloat((ax[c] * bb - bx[c] * ab) / determinant, 0.0f, 255.0f);
+		endpoint1[c] = clampFloat((bx[c] * aa - ax[c] * ab) / determinant, 0.0f, 255.0f);
+	}
+
+	return true;
+}
+
+static uint32_t colorDistance(const uint8_t *texel, const int *color, uint32_t channelCount) {
+	uint32_t distance = 0;
+
+	for (uint32_t c = 0; c < channelCount; c++) {
+		int difference = texel[c] - color[c];
+		distance += difference * difference;
+	}
+
+	return distance;
+}
+
+// BC1
+
+static uint16_t colorPack(const float color[4]) {
+	int r = clampInt((int)(color[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+	int g = clampInt((int)(color[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+	int b = clampInt((int)(color[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void colorUnpack(uint16_t packed, int color[4]) {
+	int r = (packed >> 11) & 31;
+	int g = (packed >> 5) & 63;
+	int b = packed & 31;
+
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+	color[3] = 255;
+}
+
+// writes the block for the endpoints given, returns its error and the weight every texel ended up with
+static uint32_t colorBlockTry(const uint8_t *texels, const bool *opaque, bool transparent, bool fourColors,
+		const float endpoint0[4], const float endpoint1[4], uint8_t *block, float *weights) {
+	uint16_t color0 = colorPack(endpoint0);
+	uint16_t color1 = colorPack(endpoint1);
+
+	// the endpoint order selects the mode, four colors when the first one is larger
+	if (transparent ? color0 > color1 : color0 < color1) {
+		uint16_t swap = color0;
+		color0 = color1;
+		color1 = swap;
+	}
+
+	int palette[4][4];
+	colorUnpack(color0, palette[0]);
+	colorUnpack(color1, palette[1]);
+
+	float paletteWeights[4] = { 0.0f, 1.0f, 0.0f, 0.0f };
+	uint32_t paletteSize;
+
+	// BC3 color blocks always use four colors
+	if (fourColors || color0 > color1) {
+		for (uint32_t c = 0; c < 3; c++) {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+
+		paletteWeights[2] = 1.0f / 3.0f;
+		paletteWeights[3] = 2.0f / 3.0f;
+		paletteSize = 4;
+	} else {
+		for (uint32_t c = 0; c < 3; c++)
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+
+		paletteWeights[2] = 0.5f;
+		paletteSize = 3;
+	}
+
+	uint32_t indices = 0;
+	uint32_t error = 0;
+
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+		// the fourth entry of the three color mode is transparent black
+		uint32_t bestIndex = 3;
+		uint32_t bestDistance = 0;
+
+		if (opaque[i]) {
+			bestDistance = UINT32_MAX;
+
+			for (uint32_t p = 0; p < paletteSize; p++) {
+				uint32_t distance = colorDistance(&texels[i * 4], palette[p], 3);
+
+				if (distance < bestDistance) {
+					bestIndex = p;
+					bestDistance = distance;
+				}
+			}
+		}
+
+		indices |= bestIndex << (i * 2);
+		error += bestDistance;
+		weights[i] = paletteWeights[bestIndex];
+	}
+
+	block[0] = color0 & 0xFF;
+	block[1] = color0 >> 8;
+	block[2] = color1 & 0xFF;
+	block[3] = color1 >> 8;
+
+	for (uint32_t i = 0; i < 4; i++)
+		block[4 + i] = (indices >> (i * 8)) & 0xFF;
+
+	return error;
+}
+
+static void colorBlockEncode(const uint8_t *texels, const bool *opaque, bool transparent, bool fourColors,
+		uint8_t *block) {
+	float endpoint0[4], endpoint1[4];
+	float weights[BLOCK_TEXELS];
+
+	axisEndpoints(texels, opaque, 3, endpoint0, endpoint1);
+	uint32_t error = colorBlockTry(texels, opaque, transparent, fourColors, endpoint0, endpoint1, block, weights);
+
+	if (!leastSquaresEndpoints(texels, opaque, weights, 3, endpoint0, endpoint1))
+		return;
+
+	uint8_t refined[8];
+	if (colorBlockTry(texels, opaque, transparent, fourColors, endpoint0, endpoint1, refined, weights) < error)
+		memcpy(block, refined, sizeof(refined));
+}
+
+void bc1EncodeBlock(const uint8_t *texels, uint8_t *block) {
+	bool opaque[BLOCK_TEXELS];
+	uint32_t opaqueCount = 0;
+
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+		opaque[i] = texels[i * 4 + 3] >= ALPHA_THRESHOLD;
+		opaqueCount += opaque[i] ? 1 : 0;
+	}
+
+	// equal endpoints select the three color mode, every index points at transparent black
+	if (opaqueCount == 0) {
+		memset(block, 0, 4);
+		memset(block + 4, 0xFF, 4);
+		return;
+	}
+
+	colorBlockEncode(texels, opaque, opaqueCount < BLOCK_TEXELS, false, block);
+}
+
+// BC3
+
+static void alphaBlockEncode(const uint8_t *texels, uint8_t *block) {
+	int minimum = 255;
+	int maximum = 0;
+
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+		minimum = texels[i * 4 + 3] < minimum ? texels[i * 4 + 3] : minimum;
+		maximum = texels[i * 4 + 3] > maximum ? texels[i * 4 + 3] : maximum;
+	}
+
+	memset(block, 0, 8);
+	block[0] = maximum;
+	block[1] = minimum;
+
+	// every index on the first endpoint
+	if (minimum == maximum)
+		return;
+
+	// the first endpoint being larger selects six interpolated values in between
+	int palette[8];
+	palette[0] = maximum;
+	palette[1] = minimum;
+
+	for (int i = 1; i < 7; i++)
+		palette[i + 1] = ((7 - i) * maximum + i * minimum + 3) / 7;
+
+	uint64_t indices = 0;
+
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+		uint64_t bestIndex = 0;
+		int bestDistance = INT32_MAX;
+
+		for (uint32_t p = 0; p < 8; p++) {
+			int distance = std::abs(texels[i * 4 + 3] - palette[p]);
+
+			if (distance < bestDistance) {
+				bestIndex = p;
+				bestDistance = distance;
+			}
+		}
+
+		indices |= bestIndex << (i * 3);
+	}
+
+	for (uint32_t i = 0; i < 6; i++)
+		block[2 + i] = (indices >> (i * 8)) & 0xFF;
+}
+
+void bc3EncodeBlock(const uint8_t *texels, uint8_t *block) {
+	bool opaque[BLOCK_TEXELS];
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+		opaque[i] = true;
+
+	alphaBlockEncode(texels, block);
+	colorBlockEncode(texels, opaque, false, true, block + 8);
+}
+
+// BC7
+
+static void bitsWrite(uint8_t *block, uint32_t *offset, uint32_t value, uint32_t count) {
+	for (uint32_t i = 0; i < count; i++) {
+		uint32_t bit = *offset + i;
+
+		if ((value >> i) & 1)
+			block[bit / 8] |= 1 << (bit % 8);
+	}
+
+	*offset += count;
+}
+
+// seven bits per channel plus a low bit shared by all of them, whichever low bit fits better
+static void bc7EndpointQuantize(const float endpoint[4], uint8_t quantized[4], uint8_t *lowBit) {
+	float bestError = FLT_MAX;
+
+	for (uint8_t bit = 0; bit < 2; bit++) {
+		uint8_t candidate[4];
+		float error = 0.0f;
+
+		for (uint32_t c = 0; c < 4; c++) {
+			candidate[c] = clampInt((int)((endpoint[c] - bit) / 2.0f + 0.5f), 0, 127);
+
+			float difference = ((candidate[c] << 1) | bit) - endpoint[c];
+			error += difference * difference;
+		}
+
+		if (error < bestError) {
+			bestError = error;
+			memcpy(quantized, candidate, 4);
+			*lowBit = bit;
+		}
+	}
+}
+
+static uint32_t bc7BlockTry(const uint8_t *texels, const float endpoint0[4], const float endpoint1[4],
+		uint8_t *block, float *weights) {
+	uint8_t quantized[2][4];
+	uint8_t lowBits[2];
+
+	bc7EndpointQuantize(endpoint0, quantized[0], &lowBits[0]);
+	bc7EndpointQuantize(endpoint1, quantized[1], &lowBits[1]);
+
+	int palette[16][4];
+
+	for (uint32_t c = 0; c < 4; c++) {
+		int value0 = (quantized[0][c] << 1) | lowBits[0];
+		int value1 = (quantized[1][c] << 1) | lowBits[1];
+
+		for (uint32_t p = 0; p < 16; p++)
+			palette[p][c] = ((64 - BC7_WEIGHTS[p]) * value0 + BC7_WEIGHTS[p] * value1 + 32) >> 6;
+	}
+
+	uint32_t indices[BLOCK_TEXELS];
+	uint32_t error = 0;
+
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+		uint32_t bestDistance = UINT32_MAX;
+
+		for (uint32_t p = 0; p < 16; p++) {
+			uint32_t distance = colorDistance(&texels[i * 4], palette[p], 4);
+
+			if (distance < bestDistance) {
+				indices[i] = p;
+				bestDistance = distance;
+			}
+		}
+
+		error += bestDistance;
+	}
+
+	// the first index is stored without its top bit, swapping the endpoints keeps it below 8
+	if (indices[0] >= 8) {
+		for (uint32_t c = 0; c < 4; c++) {
+			uint8_t swap = quantized[0][c];
+			quantized[0][c] = quantized[1][c];
+			quantized[1][c] = swap;
+		}
+
+		uint8_t swap = lowBits[0];
+		lowBits[0] = lowBits[1];
+		lowBits[1] = swap;
+
+		for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+			indices[i] = 15 - indices[i];
+	}
+
+	memset(block, 0, 16);
+	uint32_t offset = 0;
+
+	// mode 6 is six zero bits followed by a one
+	bitsWrite(block, &offset, 1 << 6, 7);
+
+	for (uint32_t c = 0; c < 4; c++) {
+		bitsWrite(block, &offset, quantized[0][c], 7);
+		bitsWrite(block, &offset, quantized[1][c], 7);
+	}
+
+	bitsWrite(block, &offset, lowBits[0], 1);
+	bitsWrite(block, &offset, lowBits[1], 1);
+
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+		bitsWrite(block, &offset, indices[i], i == 0 ? 3 : 4);
+		weights[i] = BC7_WEIGHTS[indices[i]] / 64.0f;
+	}
+
+	return error;
+}
+
+void bc7EncodeBlock(const uint8_t *texels, uint8_t *block) {
+	bool mask[BLOCK_TEXELS];
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+		mask[i] = true;
+
+	float endpoint0[4], endpoint1[4];
+	float weights[BLOCK_TEXELS];
+
+	axisEndpoints(texels, mask, 4, endpoint0, endpoint1);
+	uint32_t error = bc7BlockTry(texels, endpoint0, endpoint1, block, weights);
+
+	// the weights follow the endpoints as written, swapped or not, and so does the refit
+	if (!leastSquaresEndpoints(texels, mask, weights, 4, endpoint0, endpoint1))
+		return;
+
+	uint8_t refined[16];
+	if (bc7BlockTry(texels, endpoint0, endpoint1, refined, weights) < error)
+		memcpy(block, refined, sizeof(refined));
+}
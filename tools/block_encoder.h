@@ -0,0 +1,16 @@
+#ifndef BLOCK_ENCODER_H
+#define BLOCK_ENCODER_H
+
+#include <cstdint>
+
+// Every encoder takes the 16 RGBA8 texels of a 4x4 block, row by row, fits the endpoints along the
+// principal axis of the colors and refits them once to the indices picked for that first guess.
+
+// 8 bytes, blocks with texels under half alpha use the mode with a transparent index
+void bc1EncodeBlock(const uint8_t *texels, uint8_t *block);
+// 16 bytes, interpolated alpha followed by an opaque BC1 block
+void bc3EncodeBlock(const uint8_t *texels, uint8_t *block);
+// 16 bytes, always mode 6, a single RGBA endpoint pair with 4 bit indices
+void bc7EncodeBlock(const uint8_t *texels, uint8_t *block);
+
+#endif // !BLOCK_ENCODER_H
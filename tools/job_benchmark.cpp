@@ -0,0 +1,81 @@
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "core/job_system.h"
+
+// measures raw scheduling overhead, every job is empty
+const uint32_t EMPTY_JOB_COUNT = 200000;
+
+// measures scaling, every element does a fixed amount of arithmetic
+const uint32_t ELEMENT_COUNT = 1 << 20;
+const uint32_t BATCH_SIZE = 1024;
+const uint32_t ITERATIONS = 64;
+
+static double currentTime() {
+	std::chrono::duration<double> time = std::chrono::steady_clock::now().time_since_epoch();
+	return time.count();
+}
+
+static double emptyJobs() {
+	JobSystem &jobSystem = JobSystem::singleton();
+	JobCounter counter;
+
+	double start = currentTime();
+
+	for (uint32_t i = 0; i < EMPTY_JOB_COUNT; i++)
+		jobSystem.schedule([]() {}, &counter);
+
+	jobSystem.wait(counter);
+	return currentTime() - start;
+}
+
+static double parallelWork(std::vector<float> &values) {
+	double start = currentTime();
+
+	JobSystem::singleton().parallelFor(ELEMENT_COUNT, BATCH_SIZE, [&values](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; i++) {
+			float value = values[i];
+
+			for (uint32_t j = 0; j < ITERATIONS; j++)
+				value = std::sqrt(value * value + 1.0f);
+
+			values[i] = value;
+		}
+	});
+
+	return currentTime() - start;
+}
+
+int main() {
+	uint32_t threadCount = std::thread::hardware_concurrency();
+	if (threadCount == 0)
+		threadCount = 1;
+
+	std::vector<float> values(ELEMENT_COUNT, 1.0f);
+	double baseline = 0.0;
+
+	printf("threads  empty jobs/s  parallel for ms  speedup\n");
+
+	for (uint32_t threads = 1; threads <= threadCount; threads++) {
+		// the calling thread works too, so one thread means no workers at all
+		if (threads > 1)
+			JobSystem::singleton().initialize(threads - 1);
+
+		double emptyTime = emptyJobs();
+		double workTime = parallelWork(values);
+
+		if (threads == 1)
+			baseline = workTime;
+
+		printf("%7u  %12.0f  %15.2f  %7.2f\n", threads, EMPTY_JOB_COUNT / emptyTime, workTime * 1000.0,
+				baseline / workTime);
+
+		JobSystem::singleton().finalize();
+	}
+
+	return 0;
+}
@@ -0,0 +1,99 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "core/job_system.h"
+#include "io/pixel_conversion.h"
+
+// a 4096x4096 image, large enough to be split into batches
+const uint32_t PIXEL_COUNT = 4096 * 4096;
+const uint32_t REPEATS = 10;
+
+static double currentTime() {
+	std::chrono::duration<double> time = std::chrono::steady_clock::now().time_since_epoch();
+	return time.count();
+}
+
+// the per pixel copy the image loader used before the conversion kernels
+static void expandMemcpy(const uint8_t *src, uint32_t channelCount, uint8_t *dst, size_t count) {
+	for (size_t pixel = 0; pixel < count; pixel++) {
+		uint8_t channels[4] = { 0, 0, 0, 255 };
+		memcpy(channels, &src[pixel * channelCount], channelCount);
+		memcpy(&dst[pixel * 4], channels, 4);
+	}
+}
+
+// best of several runs in megapixels per second
+template <typename F>
+static double measure(const F &function) {
+	double best = 0.0;
+
+	for (uint32_t i = 0; i < REPEATS; i++) {
+		double start = currentTime();
+		function();
+		double time = currentTime() - start;
+
+		if (best == 0.0 || time < best)
+			best = time;
+	}
+
+	return PIXEL_COUNT / best / 1e6;
+}
+
+static void benchmark(const char *name, const std::vector<uint8_t> &src, std::vector<uint8_t> &dst,
+		void (*convert)(const uint8_t *, uint8_t *, size_t)) {
+	double kernel = measure([&]() { convert(src.data(), dst.data(), PIXEL_COUNT); });
+	printf("%-12s  %10s  %10.0f\n", name, "", kernel);
+}
+
+static void benchmarkExpand(const char *name, uint32_t channelCount, const std::vector<uint8_t> &src,
+		std::vector<uint8_t> &dst) {
+	double baseline = measure([&]() { expandMemcpy(src.data(), channelCount, dst.data(), PIXEL_COUNT); });
+	double kernel = measure([&]() { pixelsToRGBA(src.data(), channelCount, dst.data(), PIXEL_COUNT); });
+	printf("%-12s  %10.0f  %10.0f\n", name, baseline, kernel);
+}
+
+static void run() {
+	std::vector<uint8_t> src(PIXEL_COUNT * 4);
+	std::vector<uint8_t> dst(PIXEL_COUNT * 4);
+	std::vector<float> linear(PIXEL_COUNT * 4);
+
+	for (size_t i = 0; i < src.size(); i++)
+		src[i] = (i * 2654435761u) >> 24;
+
+	printf("%-12s  %10s  %10s\n", "Mpx/s", "memcpy", pixelConversionTarget());
+
+	benchmarkExpand("gray", 1, src, dst);
+	benchmarkExpand("gray alpha", 2, src, dst);
+	benchmarkExpand("rgb", 3, src, dst);
+
+	benchmark("swizzle", src, dst, pixelsSwizzleBGRA);
+	benchmark("premultiply", src, dst, pixelsPremultiply);
+
+	double decode = measure([&]() { pixelsSRGBToLinear(src.data(), linear.data(), PIXEL_COUNT); });
+	printf("%-12s  %10s  %10.0f\n", "srgb decode", "", decode);
+}
+
+int main() {
+	uint32_t threadCount = std::thread::hardware_concurrency();
+	if (threadCount == 0)
+		threadCount = 1;
+
+	printf("single thread\n");
+	run();
+
+	if (threadCount == 1)
+		return 0;
+
+	// the memcpy column stays single threaded, it shows what the loader did per thread
+	JobSystem::singleton().initialize(threadCount - 1);
+
+	printf("\n%u threads\n", threadCount);
+	run();
+
+	JobSystem::singleton().finalize();
+	return 0;
+}
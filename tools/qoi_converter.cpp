@@ -0,0 +1,115 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <stb/stb_image.h>
+
+#include "io/image.h"
+#include "io/qoi.h"
+
+static double currentTime() {
+	std::chrono::duration<double> time = std::chrono::steady_clock::now().time_since_epoch();
+	return time.count();
+}
+
+static bool fileRead(const char *filename, std::vector<uint8_t> *bytes) {
+	FILE *file = fopen(filename, "rb");
+	if (file == nullptr)
+		return false;
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	bytes->resize(size > 0 ? size : 0);
+	bool success = size > 0 && fread(bytes->data(), size, 1, file) == 1;
+	fclose(file);
+	return success;
+}
+
+// the source name with its extension swapped for .qoi
+static std::string outputPath(const char *input) {
+	std::string path = input;
+	size_t slash = path.find_last_of('/');
+	size_t dot = path.find_last_of('.');
+
+	if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+		path.erase(dot);
+
+	return path + ".qoi";
+}
+
+// converts one file and checks it decodes back to the same pixels, adds decode times of both formats
+static bool convert(const char *input, double *sourceTime, double *qoiTime) {
+	std::vector<uint8_t> source;
+	if (!fileRead(input, &source)) {
+		printf("%s: could not be read\n", input);
+		return false;
+	}
+
+	// straight from stb, the image loader would premultiply and QOI keeps straight alpha
+	double start = currentTime();
+	int width, height, channels;
+	stbi_uc *data = stbi_load_from_memory(source.data(), source.size(), &width, &height, &channels, 4);
+	*sourceTime += currentTime() - start;
+
+	if (data == nullptr) {
+		printf("%s: %s\n", input, stbi_failure_reason());
+		return false;
+	}
+
+	size_t size = (size_t)width * height * 4;
+
+	Image image(width, height, 1, IMAGE_FORMAT_RGBA8, imageStorageAdopt(data, size));
+	image.colorSpaceSet(IMAGE_COLOR_SPACE_SRGB);
+
+	std::string output = outputPath(input);
+	if (!qoiSave(output.c_str(), &image)) {
+		printf("%s: could not be written\n", output.c_str());
+		return false;
+	}
+
+	std::vector<uint8_t> encoded;
+	fileRead(output.c_str(), &encoded);
+
+	start = currentTime();
+	Image decoded;
+	bool valid = qoiLoadFromMemory(encoded.data(), encoded.size(), &decoded);
+	*qoiTime += currentTime() - start;
+
+	if (!valid || decoded.size() != size || memcmp(decoded.data(), image.data(), size) != 0) {
+		printf("%s: decoded pixels differ from the source!\n", output.c_str());
+		return false;
+	}
+
+	printf("%s: %zu KiB -> %s: %zu KiB\n", input, source.size() / 1024, output.c_str(), encoded.size() / 1024);
+	return true;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc < 2) {
+		printf("Usage: qoi_converter INPUT...\n");
+		printf("Writes every input next to itself with a .qoi extension.\n");
+		return EXIT_FAILURE;
+	}
+
+	double sourceTime = 0.0;
+	double qoiTime = 0.0;
+	uint32_t failed = 0;
+
+	for (int i = 1; i < argc; i++) {
+		if (!convert(argv[i], &sourceTime, &qoiTime))
+			failed++;
+	}
+
+	printf("Decode time: %.1lf ms source, %.1lf ms QOI\n", sourceTime * 1000.0, qoiTime * 1000.0);
+
+	if (failed > 0)
+		printf("%u of %d files failed!\n", failed, argc - 1);
+
+	return failed > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
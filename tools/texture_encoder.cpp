@@ -0,0 +1,225 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "core/job_system.h"
+#include "io/image.h"
+#include "io/image_loader.h"
+#include "io/ktx2.h"
+#include "io/pixel_conversion.h"
+
+#include "block_encoder.h"
+
+// blocks per job, a few rows of a large texture
+const uint32_t BLOCK_BATCH_SIZE = 1024;
+
+typedef void (*BlockEncodeFunction)(const uint8_t *texels, uint8_t *block);
+
+static double currentTime() {
+	std::chrono::duration<double> time = std::chrono::steady_clock::now().time_since_epoch();
+	return time.count();
+}
+
+static uint32_t levelDimension(uint32_t size, uint32_t level) {
+	size >>= level;
+	return size > 0 ? size : 1;
+}
+
+// box filters the level above, odd sizes clamp the last row and column
+static void levelDownsample(const uint8_t *source, uint32_t sourceWidth, uint32_t sourceHeight, uint8_t *destination,
+		uint32_t width, uint32_t height) {
+	JobSystem::singleton().parallelFor(height, 16, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t y = begin; y < end; y++) {
+			uint32_t y0 = y * 2 < sourceHeight ? y * 2 : sourceHeight - 1;
+			uint32_t y1 = y * 2 + 1 < sourceHeight ? y * 2 + 1 : sourceHeight - 1;
+
+			for (uint32_t x = 0; x < width; x++) {
+				uint32_t x0 = x * 2 < sourceWidth ? x * 2 : sourceWidth - 1;
+				uint32_t x1 = x * 2 + 1 < sourceWidth ? x * 2 + 1 : sourceWidth - 1;
+
+				for (uint32_t c = 0; c < 4; c++) {
+					uint32_t sum = source[(y0 * sourceWidth + x0) * 4 + c] + source[(y0 * sourceWidth + x1) * 4 + c] +
+							source[(y1 * sourceWidth + x0) * 4 + c] + source[(y1 * sourceWidth + x1) * 4 + c];
+
+					destination[(y * width + x) * 4 + c] = (sum + 2) / 4;
+				}
+			}
+		}
+	});
+}
+
+// the same filter in linear light, averaging sRGB encoded values would darken every level
+static void levelDownsampleSRGB(const uint8_t *source, uint32_t sourceWidth, uint32_t sourceHeight,
+		uint8_t *destination, uint32_t width, uint32_t height) {
+	JobSystem::singleton().parallelFor(height, 16, [&](uint32_t begin, uint32_t end) {
+		std::vector<float> sourceRows(sourceWidth * 4 * 2);
+		std::vector<float> row(width * 4);
+
+		float *row0 = sourceRows.data();
+		float *row1 = sourceRows.data() + sourceWidth * 4;
+
+		for (uint32_t y = begin; y < end; y++) {
+			uint32_t y0 = y * 2 < sourceHeight ? y * 2 : sourceHeight - 1;
+			uint32_t y1 = y * 2 + 1 < sourceHeight ? y * 2 + 1 : sourceHeight - 1;
+
+			pixelsSRGBToLinear(&source[(size_t)y0 * sourceWidth * 4], row0, sourceWidth);
+			pixelsSRGBToLinear(&source[(size_t)y1 * sourceWidth * 4], row1, sourceWidth);
+
+			for (uint32_t x = 0; x < width; x++) {
+				uint32_t x0 = x * 2 < sourceWidth ? x * 2 : sourceWidth - 1;
+				uint32_t x1 = x * 2 + 1 < sourceWidth ? x * 2 + 1 : sourceWidth - 1;
+
+				for (uint32_t c = 0; c < 4; c++) {
+					float sum = row0[x0 * 4 + c] + row0[x1 * 4 + c] + row1[x0 * 4 + c] + row1[x1 * 4 + c];
+					row[x * 4 + c] = sum * 0.25f;
+				}
+			}
+
+			pixelsLinearToSRGB(row.data(), &destination[(size_t)y * width * 4], width);
+		}
+	});
+}
+
+static void levelEncode(const uint8_t *texels, uint32_t width, uint32_t height, BlockEncodeFunction encode,
+		uint32_t blockSize, uint8_t *blocks) {
+	uint32_t blocksX = (width + 3) / 4;
+	uint32_t blocksY = (height + 3) / 4;
+
+	JobSystem::singleton().parallelFor(blocksX * blocksY, BLOCK_BATCH_SIZE, [&](uint32_t begin, uint32_t end) {
+		uint8_t block[16 * 4];
+
+		for (uint32_t i = begin; i < end; i++) {
+			uint32_t blockX = i % blocksX;
+			uint32_t blockY = i / blocksX;
+
+			// edge blocks repeat the last texel, the padding is never sampled
+			for (uint32_t y = 0; y < 4; y++) {
+				uint32_t texelY = blockY * 4 + y < height ? blockY * 4 + y : height - 1;
+
+				for (uint32_t x = 0; x < 4; x++) {
+					uint32_t texelX = blockX * 4 + x < width ? blockX * 4 + x : width - 1;
+					memcpy(&block[(y * 4 + x) * 4], &texels[(texelY * width + texelX) * 4], 4);
+				}
+			}
+
+			encode(block, &blocks[(size_t)i * blockSize]);
+		}
+	});
+}
+
+static void usage() {
+	printf("Usage: texture_encoder [--bc1 | --bc3 | --bc7] [--no-mipmaps] INPUT OUTPUT.ktx2\n");
+}
+
+int main(int argc, char *argv[]) {
+	ImageFormat format = IMAGE_FORMAT_BC7;
+	bool mipmaps = true;
+	const char *input = nullptr;
+	const char *output = nullptr;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp("--bc1", argv[i]) == 0) {
+			format = IMAGE_FORMAT_BC1;
+		} else if (strcmp("--bc3", argv[i]) == 0) {
+			format = IMAGE_FORMAT_BC3;
+		} else if (strcmp("--bc7", argv[i]) == 0) {
+			format = IMAGE_FORMAT_BC7;
+		} else if (strcmp("--no-mipmaps", argv[i]) == 0) {
+			mipmaps = false;
+		} else if (input == nullptr) {
+			input = argv[i];
+		} else if (output == nullptr) {
+			output = argv[i];
+		} else {
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (input == nullptr || output == nullptr) {
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	JobSystem::singleton().initialize(0);
+
+	Image image;
+	if (!imageLoad(input, &image) || image.format() != IMAGE_FORMAT_RGBA8) {
+		printf("Input must be an uncompressed image!\n");
+		JobSystem::singleton().finalize();
+		return EXIT_FAILURE;
+	}
+
+	double start = currentTime();
+
+	uint32_t width = image.width();
+	uint32_t height = image.height();
+
+	uint32_t mipLevels = 1;
+	while (mipmaps && (width >> mipLevels > 0 || height >> mipLevels > 0))
+		mipLevels++;
+
+	BlockEncodeFunction encode = bc7EncodeBlock;
+	if (format == IMAGE_FORMAT_BC1)
+		encode = bc1EncodeBlock;
+	else if (format == IMAGE_FORMAT_BC3)
+		encode = bc3EncodeBlock;
+
+	uint32_t blockSize = format == IMAGE_FORMAT_BC1 ? 8 : 16;
+
+	size_t size = 0;
+	for (uint32_t level = 0; level < mipLevels; level++)
+		size += imageFormatSize(format, levelDimension(width, level), levelDimension(height, level));
+
+	uint8_t *data = (uint8_t *)malloc(size);
+	size_t offset = 0;
+
+	// the level being encoded and the one downsampled from it
+	uint8_t *texels = image.data();
+	uint8_t *previous = nullptr;
+
+	bool srgb = image.colorSpace() == IMAGE_COLOR_SPACE_SRGB;
+
+	for (uint32_t level = 0; level < mipLevels; level++) {
+		uint32_t levelWidth = levelDimension(width, level);
+		uint32_t levelHeight = levelDimension(height, level);
+
+		if (level > 0) {
+			uint8_t *downsampled = (uint8_t *)malloc((size_t)levelWidth * levelHeight * 4);
+			uint32_t sourceWidth = levelDimension(width, level - 1);
+			uint32_t sourceHeight = levelDimension(height, level - 1);
+
+			if (srgb)
+				levelDownsampleSRGB(texels, sourceWidth, sourceHeight, downsampled, levelWidth, levelHeight);
+			else
+				levelDownsample(texels, sourceWidth, sourceHeight, downsampled, levelWidth, levelHeight);
+
+			free(previous);
+			previous = downsampled;
+			texels = downsampled;
+		}
+
+		levelEncode(texels, levelWidth, levelHeight, encode, blockSize, data + offset);
+		offset += imageFormatSize(format, levelWidth, levelHeight);
+	}
+
+	free(previous);
+
+	// the loader premultiplied the input, compressed blocks could not be multiplied after loading
+	Image encoded(width, height, mipLevels, format, imageStorageAdopt(data, size));
+	encoded.colorSpaceSet(image.colorSpace());
+	encoded.premultipliedSet(image.isPremultiplied());
+	double elapsed = currentTime() - start;
+
+	bool success = ktx2Save(output, &encoded);
+	if (success) {
+		printf("Encoded %u levels in %.1lf ms\n", mipLevels, elapsed * 1000.0);
+		printf("Size: %zu KiB, %zu KiB uncompressed without mipmaps\n", size / 1024, image.size() / 1024);
+	}
+
+	JobSystem::singleton().finalize();
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}